@@ -6,50 +6,3364 @@
 #include <QDir>
 #include <QSet>
 #include <QThread>
+#include <QFile>
+#include <QHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTextCodec>
+#include <QCryptographicHash>
+#include <QFutureInterface>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtConcurrent/QtConcurrentMap>
 #include <mutex>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 // ̱߳ش洢Ķ
 namespace ini {
 	static std::mutex mutex;
+
+#ifdef LIBINI_TRACE
+	// ¼, ʱ䵥λΪ
+	struct TraceEvent {
+		const char* name;
+		qint64 begin;
+		qint64 duration;
+		DWORD tid;
+	};
+
+	// ¼¼, Chromeٸʽ
+	class Tracer {
+	public:
+		// ¼¼, , ⳤʱʱڴ
+		static constexpr int kMaxEvents = 1000000;
+
+		static Tracer& instance() {
+			static Tracer tracer;
+			return tracer;
+		}
+
+		inline qint64 now() const {
+			return clock_.nsecsElapsed();
+		}
+
+		void add(const char* name, qint64 begin, qint64 end) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (events_.size() < kMaxEvents) {
+				events_.append({ name, begin, end - begin, ::GetCurrentThreadId() });
+			}
+		}
+
+		bool save(const QString& path) {
+			QVector<TraceEvent> events;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				events.swap(events_);
+			}
+
+			auto pid = QByteArray::number(static_cast<quint32>(::GetCurrentProcessId()));
+			QByteArray data = "{\"traceEvents\":[";
+			for (int i = 0; i < events.size(); ++i) {
+				const auto& x = events[i];
+				data += i ? ",\n" : "\n";
+				data += "{\"name\":\"";
+				data += x.name;
+				data += "\",\"cat\":\"libini\",\"ph\":\"X\",\"ts\":";
+				data += QByteArray::number(x.begin / 1000.0, 'f', 3);
+				data += ",\"dur\":";
+				data += QByteArray::number(x.duration / 1000.0, 'f', 3);
+				data += ",\"pid\":" + pid + ",\"tid\":";
+				data += QByteArray::number(static_cast<quint32>(x.tid));
+				data += "}";
+			}
+			data += "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+			QFile file(path);
+			if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+				return false;
+			}
+			return file.write(data) == data.size();
+		}
+
+	private:
+		inline Tracer() {
+			clock_.start();
+		}
+
+		QElapsedTimer clock_;
+		std::mutex mutex_;
+		QVector<TraceEvent> events_;
+	};
+
+	// ¼ĸ¼
+	class TraceScope {
+	public:
+		inline explicit TraceScope(const char* name) : name_(name), begin_(Tracer::instance().now()) {}
+
+		inline ~TraceScope() {
+			auto& tracer = Tracer::instance();
+			tracer.add(name_, begin_, tracer.now());
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* name_;
+		qint64 begin_;
+	};
+
+#define INI_TRACE_CONCAT_IMPL(a, b) a##b
+#define INI_TRACE_CONCAT(a, b) INI_TRACE_CONCAT_IMPL(a, b)
+#define INI_TRACE_SCOPE(name) ini::TraceScope INI_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#else
+	// δLIBINI_TRACEʱκδ
+#define INI_TRACE_SCOPE(name)
+#endif
+
+	/*
+	* @brief Ʊ, ĵͬĽֻһ, ԱűȽ
+	* @note ִСд, һγʱд. ҽQStringViewQLatin1String, ڴ
+	*/
+	class NameTable {
+	public:
+		// , ʱ, ر
+		template<typename View>
+		int intern(View name);
+
+		// , ʱ-1
+		template<typename View>
+		int find(View name) const;
+
+		inline const QString& name(int id) const {
+			return names_[id];
+		}
+
+		// 뱣дȫͬʱعַ, һ
+		inline QString spelling(int id, QStringView name) const {
+			return QStringView(names_[id]) == name ? names_[id] : name.toString();
+		}
+
+		inline QString spelling(int id, QLatin1String name) const {
+			return names_[id] == name ? names_[id] : QString(name);
+		}
+
+		inline int size() const {
+			return names_.size();
+		}
+
+		void clear();
+
+	private:
+		static inline uint fold(uint c) {
+			if (c < 0x80) {
+				return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+			}
+			return QChar::toCaseFolded(c);
+		}
+
+		template<typename View>
+		static uint hash(View name);
+
+		static inline QString toString(QStringView name) {
+			return name.toString();
+		}
+
+		static inline QString toString(QLatin1String name) {
+			return QString(name);
+		}
+
+		static inline bool equals(const QString& a, QStringView b) {
+			return QStringView(a).compare(b, Qt::CaseInsensitive) == 0;
+		}
+
+		static inline bool equals(const QString& a, QLatin1String b) {
+			return QString::compare(a, b, Qt::CaseInsensitive) == 0;
+		}
+
+		void rehash(int capacity);
+
+		QVector<QString> names_;       //  -> 
+		QVector<uint> hashes_;         //  -> ϣֵ
+		QVector<int> slots_;           // ѰַĹϣ, , -1Ϊ, СΪ2ݴ
+	};
+
+	// Ŀ, keyΪʱʾԭ(;ͷע)
+	struct Entry {
+		QString key;
+		QString value;
+		int chunk = 0;                 // borrowedΪtrueʱֵڵarena, offset, sizeһԭʼֽ(ĵ)
+		int offset = 0;
+		int size = 0;
+		int name = -1;                 // Ʊеı, keyΪʱΪ-1
+		bool borrowed = false;         // ֵĵarenaе, ʱvalueΪ, ĵ֮ǰDocument::detach
+		QString plain;                 // ֵܺ, decryptedΪtrueʱЧ
+		bool decrypted = false;
+		int origin = -1;               // ϲ²ļʱֵڵĲ, ĵΪ-1
+	};
+
+	/*
+	* @brief ·, \/ָļ㼶֯, гӼʱֻʶӦڵӽڵ
+	* @note ÿһƱ, ִСд
+	*/
+	class KeyTree {
+	public:
+		struct Node {
+			int name = -1;                 // òƱеı, ڵΪ-1
+			QString spelling;              // òƵһγʱд
+			bool key = false;              // Ӹ˽ڵ·ǷΪһ
+			int number = 0;                // Ϊʱֵ, Ԫص
+			QVector<int> children;         // ӽڵ±, һγֵ˳
+			QHash<int, int> index;         // Ʊ -> ӽڵ±
+			QVector<int> elements;         // ѴڵԪ, , ֻ¼ڵ, ŵĴС޹
+			int contiguous = 0;            // 1ʼڵԪ
+		};
+
+		// ɽڵĿ
+		void build(const QVector<Entry>& entries, NameTable& names);
+
+		// һ
+		void insert(QStringView key, NameTable& names);
+
+		// ·ӦĽڵ, pathΪʱظڵ, ʱ-1
+		int find(QStringView path, const NameTable& names) const;
+
+		// ռڵ֮µм, ΪԸýڵ·, /ֲ㼶
+		void collect(int node, const QString& prefix, QStringList& result) const;
+
+		inline const Node& node(int index) const {
+			return nodes_[index];
+		}
+
+		inline bool built() const {
+			return built_;
+		}
+
+		// ĿɾֻʧЧ, ´ηʱ½
+		inline void invalidate() {
+			nodes_.clear();
+			built_ = false;
+		}
+
+	private:
+		// ΪʱΪԪؼ¼ڸڵ
+		void addElement(int parent, int child);
+
+		QVector<Node> nodes_;          // nodes_[0]Ϊڵ
+		bool built_ = false;
+	};
+
+	/*
+	* @brief  -> Ŀ±ĿѰַϣ
+	* @note NameTableһвλһڴ, ʱΪÿĿڵ
+	*/
+	class EntryIndex {
+	public:
+		inline int value(int name, int defaultValue) const {
+			if (slots_.isEmpty()) {
+				return defaultValue;
+			}
+
+			auto mask = slots_.size() - 1;
+			for (auto i = slot(name, mask); slots_[i].name != -1; i = (i + 1) & mask) {
+				if (slots_[i].name == name) {
+					return slots_[i].index;
+				}
+			}
+			return defaultValue;
+		}
+
+		inline bool contains(int name) const {
+			return value(name, -1) != -1;
+		}
+
+		// Ѵʱ滻±
+		void insert(int name, int index);
+
+		// ԤcountĲλ
+		void reserve(int count);
+
+		inline void clear() {
+			slots_.clear();
+			size_ = 0;
+		}
+
+	private:
+		struct Slot {
+			int name = -1;             // -1Ϊ
+			int index = -1;
+		};
+
+		static inline int slot(int name, int mask) {
+			// ƱС, Իƽָɢ
+			auto h = static_cast<uint>(name) * 2654435769u;
+			return static_cast<int>((h ^ (h >> 16)) & mask);
+		}
+
+		QVector<Slot> slots_;          // СΪ2ݴ
+		int size_ = 0;
+	};
+
+	// 
+	struct Section {
+		QString name;
+		int id = -1;               // Ʊеı
+		QVector<Entry> entries;
+		EntryIndex index;          //  -> entries±
+		bool parsed = true;        // ӳٽʱ, ״ηǰΪfalse
+		QVector<QPair<int, int>> ranges;   // δʱԭʼеķΧ[begin, end)
+		KeyTree tree;              // ·, ״гӼʱ
+
+		inline int find(int name) const {
+			return name != -1 ? index.value(name, -1) : -1;
+		}
+
+		inline void reindex() {
+			tree.invalidate();
+			index.clear();
+			index.reserve(entries.size());
+			for (int i = 0; i < entries.size(); ++i) {
+				if (entries[i].name != -1 && !index.contains(entries[i].name)) {
+					index.insert(entries[i].name, i);
+				}
+			}
+		}
+	};
+
+	/*
+	* @brief ڴеINIĵ
+	* @note GetPrivateProfileStringһ, ִСд, ظʱԵһγֵΪ׼
+	*/
+	class Document {
+	public:
+		enum class Codec {
+			Utf8,
+			Utf8Bom,           // BOMUTF-8, дʱBOM
+			Utf16,
+			Local8Bit,
+		};
+
+		/*
+		* @brief 
+		* @param[in] data ļ
+		* @param[in] lazy Ƿӳٽ, Ϊtrueʱֻɨڵı߽, ״ηʱ
+		*/
+		void parse(const QByteArray& data, bool lazy = false);
+		QByteArray serialize() const;
+		void clear();
+
+		const Section* section(QStringView name) const;
+		Section* section(QStringView name, bool create);
+		QStringList sectionNames() const;
+
+		const Entry* entry(QStringView group, QStringView key) const;
+		Entry* entry(QStringView group, QStringView key);
+		bool value(QStringView group, QStringView key, QString* value) const;
+		void setValue(QStringView group, QStringView key, const QString& value);
+		bool remove(QStringView group, QStringView key);
+		bool removeSection(QStringView group);
+
+		/*
+		* @brief ɾ·֮µм, һαڵĿ
+		* @param[in] group 
+		* @param[in] path ڵļ·, /\ֲ㼶, ɾpath
+		* @return мɾtrue
+		*/
+		bool removePath(QStringView group, QStringView path);
+
+		/*
+		* @brief ƶ·֮µм, һαԴڵĿ, ֵԭ
+		* @param[in] group Դ
+		* @param[in] path Դ·, /\ֲ㼶, ΪʱΪ
+		* @param[in] toGroup Ŀ
+		* @param[in] toPath Ŀ·, /\ֲ㼶, ΪʱΪڱ
+		* @param[in] conflict ĿѴʱĴʽ
+		* @param[out] moved ƶļ, Ϊ(ɼ, ¼), Ϊnullptr
+		* @return ƶļ, ͻĿλԴ֮ʱ-1
+		*/
+		int movePath(QStringView group, QStringView path, QStringView toGroup, QStringView toPath,
+			Ini::Conflict conflict, QVector<QPair<QString, QString>>* moved);
+
+		/*
+		* @brief г·һӼ
+		* @param[in] group 
+		* @param[in] path ڵļ·, /\ֲ㼶, Ϊʱгڵĵһ
+		* @param[in] groups Ϊtrueʱг, гӼ
+		* @return Ӽ, һγֵ˳
+		*/
+		QStringList children(QStringView group, QStringView path, bool groups) const;
+
+		/*
+		* @brief г·µм
+		* @param[in] group 
+		* @param[in] path ڵļ·, /\ֲ㼶, Ϊʱг
+		* @return pathļ·, /ֲ㼶
+		*/
+		QStringList keys(QStringView group, QStringView path) const;
+
+		/*
+		* @brief ĴС
+		* @param[in] group 
+		* @param[in] path ڽڵļ·
+		* @return path/sizeֵ, 1sizeԪزȫʱ-1
+		*/
+		int arraySize(QStringView group, QStringView path) const;
+
+		// ·ǷΪ, ӼҲ
+		bool isGroup(QStringView group, QStringView path) const;
+
+		/*
+		* @brief ʹĿֵarena
+		* @return Ŀֵ, ĵ֮ʹ
+		*/
+		const QString& detach(Entry& e);
+
+		// Ŀֵ, ıĿ
+		QString text(const Entry& e) const;
+
+		// ĿֵǷһĵĿֵͬ, ͬʱֱӱȽԭʼֽ
+		bool equals(const Entry& e, const Document& other, const Entry& x) const;
+
+	private:
+		// arenaвٱõֵֽҳԱõֽʱѹ
+		static constexpr int kCompactThreshold = 64 * 1024;
+
+		// Ʊұϴʱ, ʹõ±
+		static constexpr int kNameCompactThreshold = 4096;
+
+		// ʱļ˴С򰴽ڵıֿ߽, ̳߳вн
+		static constexpr int kParallelThreshold = 48 * 1024 * 1024;
+
+		// нʱÿСֽ
+		static constexpr int kMinChunkSize = 8 * 1024 * 1024;
+
+		void borrow(const char* begin, const char* end, Entry& e);
+
+		// Ŀõԭʼֽ
+		inline const char* raw(const Entry& e) const {
+			return arena_[e.chunk].constData() + e.offset;
+		}
+
+		void release(Entry& e);
+		void compact();
+		void shrinkNames();
+		QByteArray encode(const QString& text) const;
+		int intern(const char* data, int size, QString* spelling);
+
+		void reindex();
+		QString decode(const char* data, int size) const;
+		void parseText(const char* begin, const char* end, Section* current);
+		void parseParallel(const QByteArray& bytes);
+		void merge(Document& part);
+		void parseSection(Section& s);
+		Section* insertSection(QStringView name);
+		const KeyTree* tree(QStringView group) const;
+
+		QVector<Section> sections_;
+		NameTable names_;              // 
+		QHash<int, int> index_;        //  -> sections_±
+		Codec codec_ = Codec::Local8Bit;
+		QByteArray raw_;               // ӳٽʱԭʼ(UTF-8򱾵ر)
+		int unparsed_ = 0;             // δĽ, Ϊ0ʱͷraw_
+		int named_ = 0;                // ϴƱе
+		QVector<QByteArray> arena_;    // ļ(UTF-8򱾵ر), Ŀֱֵе
+		int live_ = 0;                 // arenaԱĿõֽ
+		int dead_ = 0;                 // arenaѲٱõֵֽ
+	};
+
+	// δд̵޸, дǰļ޸ʱط
+	struct Change {
+		enum class Type {
+			Set,
+			Remove,
+			RemoveSection,
+			RemovePath,        // ɾkey֮µм
+			AddSection,        // ڲʱս
+			Move,              // key֮µмƶtarget_groupеtarget_key
+		};
+
+		Type type;
+		QString group;
+		QString key;
+		QString value;
+		QString target_group;
+		QString target_key;
+		Ini::Conflict conflict = Ini::Conflict::Skip;
+	};
+
+	/*
+	* @brief ļ, ʹLockFileEx<file>.lock
+	* @note , ͬһڹǶ, жռʱǶ
+	*/
+	class FileLock {
+	public:
+		enum class Mode {
+			Shared,
+			Exclusive,
+		};
+
+		explicit FileLock(const QString& path);
+		~FileLock();
+
+		/*
+		* @brief 
+		* @param[in] mode ģʽ
+		* @param[in] timeout ʱʱ(), -1ʾһֱȴ, 0ʾȴ
+		* @param[in] user ǷΪûʽ
+		* @return ɹtrue, ʧܷfalse
+		*/
+		bool lock(Mode mode, int timeout, bool user = false);
+
+		/*
+		* @brief 
+		* @param[in] user ǷΪûʽ
+		* @return ɹtrue, δfalse
+		*/
+		bool unlock(bool user = false);
+
+	private:
+		FileLock(const FileLock&) = delete;
+		FileLock& operator=(const FileLock&) = delete;
+		bool acquire(Mode mode, int timeout);
+
+		QString path_;
+		HANDLE handle_ = INVALID_HANDLE_VALUE;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		Mode mode_ = Mode::Shared;
+		int count_ = 0;                // ڳд
+		int user_ = 0;                 // ûʽеĴ
+		bool busy_ = false;            // ϵͳ
+	};
+
+	// ʱֱͼ, ڶ߳ͬʱ¼
+	class Histogram {
+	public:
+		inline Histogram() {
+			reset();
+		}
+
+		void add(quint64 nsecs);
+		void snapshot(IniHistogram& h) const;
+		void reset();
+
+	private:
+		std::atomic<quint64> count_;
+		std::atomic<quint64> total_;
+		std::atomic<quint64> max_;
+		std::atomic<quint64> buckets_[IniHistogram::kBuckets];
+	};
+
+	/*
+	* @brief ĵȴͳ
+	* @note acquiredreleasingڳʱ, ݹֻͳ
+	*/
+	class LockProfile {
+	public:
+		void acquired(const char* site, quint64 waitNsecs);
+		void releasing();
+		void snapshot(IniLockStats& s) const;
+		void reset();
+
+		std::atomic<bool> enabled{ false };
+
+	private:
+		struct Site {
+			quint64 count = 0;
+			quint64 wait_total = 0;
+			quint64 wait_max = 0;
+			quint64 hold_total = 0;
+		};
+
+		Histogram wait_;
+		Histogram hold_;
+		int depth_ = 0;                    // ͳƵ
+		const char* site_ = nullptr;       // ͳƵ
+		QElapsedTimer held_;               // ͳƵ
+		mutable std::mutex sites_mutex_;
+		QHash<const char*, Site> sites_;
+	};
+
+	// ͳʱ¼ȴеĺʱ
+	template<class Mutex>
+	class ProfiledLocker {
+	public:
+		inline ProfiledLocker(Mutex* mutex, LockProfile& profile, const char* site)
+			: mutex_(mutex), profile_(profile), profiled_(profile.enabled) {
+			INI_TRACE_SCOPE("lock");
+			if (!profiled_) {
+				mutex_->lock();
+				return;
+			}
+
+			QElapsedTimer timer;
+			timer.start();
+			mutex_->lock();
+			profile_.acquired(site, timer.nsecsElapsed());
+		}
+
+		inline ~ProfiledLocker() {
+			if (profiled_) {
+				profile_.releasing();
+			}
+			mutex_->unlock();
+		}
+
+		ProfiledLocker(const ProfiledLocker&) = delete;
+		ProfiledLocker& operator=(const ProfiledLocker&) = delete;
+
+	private:
+		Mutex* mutex_;
+		LockProfile& profile_;
+		bool profiled_;
+	};
+
+	// ʵͳϢ
+	struct Stats {
+		Histogram operations[IniStats::OperationCount];
+		LockProfile mutexes[IniStats::MutexCount];
+		std::atomic<quint64> encrypt_calls{ 0 };
+		std::atomic<quint64> encrypt_time{ 0 };
+		std::atomic<quint64> decrypt_calls{ 0 };
+		std::atomic<quint64> decrypt_time{ 0 };
+		std::atomic<quint64> decrypt_cache_hits{ 0 };
+		std::atomic<quint64> decrypt_cache_misses{ 0 };
+	};
+
+	// ·Ķдͳ
+	struct IoStats {
+		std::atomic<quint64> file_reads{ 0 };
+		std::atomic<quint64> bytes_read{ 0 };
+		std::atomic<quint64> file_writes{ 0 };
+		std::atomic<quint64> bytes_written{ 0 };
+		std::atomic<quint64> parses{ 0 };
+		std::atomic<quint64> cache_hits{ 0 };
+		std::atomic<quint64> cache_misses{ 0 };
+	};
+
+	// ¼ĺʱ
+	class OperationTimer {
+	public:
+		inline explicit OperationTimer(Histogram& histogram) : histogram_(histogram) {
+			timer_.start();
+		}
+
+		inline ~OperationTimer() {
+			histogram_.add(timer_.nsecsElapsed());
+		}
+
+		OperationTimer(const OperationTimer&) = delete;
+		OperationTimer& operator=(const OperationTimer&) = delete;
+
+	private:
+		Histogram& histogram_;
+		QElapsedTimer timer_;
+	};
+
+	// ĵӦĴļ
+	struct File {
+		QString path;
+		Document doc;
+		bool loaded = false;
+		bool exists = false;           // ϵINIļǷ, ֻڼⲿ޸, docΪ׼
+		qint64 size = -1;
+		QDateTime modified;
+		QString journal;               // ־ļ·, <file>.journal
+		qint64 journal_size = -1;      // Ѽص־С, -1ʾ־
+		QDateTime journal_modified;
+		QElapsedTimer checked;         // ϴμļʱ
+		quint64 generation = 0;        // ÿ޸ĵ
+		quint64 flushed = 0;           // д̵generation
+		QVector<Change> pending;       // δд̵޸
+		quint64 version = 0;           // ÿδӴ̼ص
+	};
+
+	/*
+	* @brief ĵǰ׺, ÿڵӦ'/'ָһ(۵Сд)
+	* @note ƥһֻ·ǰ׺, 붩޹
+	*/
+	class SubscriptionTree {
+	public:
+		void insert(const QString& prefix, int id);
+		void remove(const QString& prefix, int id);
+
+		// Զpathһǰ׺ıŵfunc
+		template<typename Func>
+		void match(const QString& path, Func func) const;
+
+	private:
+		struct Node {
+			std::map<QString, std::unique_ptr<Node>> children;
+			QVector<int> ids;
+		};
+
+		static QStringList split(const QString& path);
+		static bool remove(Node& node, const QStringList& segments, int depth, int id);
+
+		Node root_;
+	};
+
+	// 
+	struct Subscription {
+		const Ini* owner;
+		QString prefix;
+		IniChangeCb callback;
+	};
+
+	/*
+	* @brief ͬһͬһ·ĵ
+	* @note дͬһ·Iniһν, ޸ĺflushϲд
+	*/
+	class Store {
+	public:
+		// μļǷⲿ޸ĵС()
+		static constexpr int kRefreshInterval = 100;
+
+		// ̨дʧܺԵļ()
+		static constexpr int kRetryInterval = 1000;
+
+		// ڶĻ²ļʱļǷ޸ĵļ()
+		static constexpr int kWatchInterval = 1000;
+
+		Store(const QString& iniFile, const QString& commentFile);
+		~Store();
+
+		File& file(const QString& path);
+
+		// ºڳmutexʱ
+		bool load(File& f);
+		void refresh(File& f);
+		void setValue(File& f, const QString& group, const QString& key, const QString& value);
+		bool remove(File& f, const QString& group, const QString& key);
+		bool addSection(File& f, const QString& group);
+		bool removePath(File& f, const QString& group, const QString& path);
+		int movePath(File& f, const QString& group, const QString& path, const QString& toGroup, const QString& toPath,
+			Ini::Conflict conflict, QVector<QPair<QString, QString>>* moved = nullptr);
+
+		/*
+		* @brief ֻ²ļ
+		* @param[in] paths ӵ͵ߵļ·
+		*/
+		void setLayers(const QStringList& paths);
+
+		/*
+		* @brief дĵ, ߳ͬʱʱϲΪһд
+		* @param[in] compact Ƿ־ϲINIļ
+		*/
+		bool flush(bool compact = false);
+
+		// ºڳmutexʱ
+		void schedule(QFutureInterface<bool>* waiter = nullptr);
+		bool waitForFlush(int timeout);
+		bool isClean();
+		int subscribe(const Ini* owner, const QString& prefix, IniChangeCb callback);
+		void unsubscribe(const Ini* owner, int id);
+		void unsubscribe(const Ini* owner);
+
+		// ݴ޸֪ͨ, ڳmutexʱ
+		void publish();
+
+		inline bool subscribed() const {
+			return subscribed_;
+		}
+
+		// Ƿ֪ͨ߳(ڶĵĻص)
+		inline bool notifying() const {
+			return notifier_.get_id() == std::this_thread::get_id();
+		}
+
+		std::mutex mutex;              // ĵ
+		std::mutex io_mutex;           // д̻
+		File ini;
+		File comment;
+		FileLock file_lock;            // ļ
+		std::atomic<bool> locking{ false };    // дʱǷʹÿļ
+		std::atomic<int> lock_timeout{ -1 };   // ļʱʱ()
+		std::atomic<int> write_delay{ 50 };    // ̨дǰϲ޸ĵĵȴʱ()
+		std::atomic<bool> lazy{ false };       // ʱǷӳٽ
+		std::atomic<bool> journaling{ false }; // Ƿ׷־ķʽд
+		std::atomic<qint64> compact_size{ 1024 * 1024 };   // ־˴С(ֽ)ʱϲ
+		std::atomic<double> compact_ratio{ 0.5 };          // ־INIļСĴ˱ʱϲ
+		std::atomic<Ini::Durability> durability{ Ini::Durability::Flush };  // д̵ĳ־û
+		IoStats stats;                         // дͳ
+		QVector<File> layers;                  // ֻ²ļ, ӵ͵, mutex
+		Document base;                         // ²ļϲĵ, iniδʱҴĵ, mutex
+
+	private:
+		static void apply(Document& doc, const Change& change);
+		static QByteArray encode(const QVector<Change>& changes);
+		void read(File& f, Document& doc);
+		void replay(File& f, Document& doc, const QByteArray& content);
+		bool changed(const File& f) const;
+		void merge(File& f);
+		void run();
+		void record(const QString& group, const QString& key);
+		void record(const Document& before, const Document& after);
+		void watch();
+		void dispatch(const QStringList& keys);
+		void refreshLayers();
+		void pollLayers();
+
+		std::thread flusher_;                  // ̨д߳
+		std::mutex flusher_mutex_;
+		std::condition_variable flusher_cv_;   // Ѻ̨д߳
+		std::condition_variable flushed_cv_;   // ÿκ̨дɺ֪ͨ
+		QVector<QFutureInterface<bool>> waiters_;
+		bool requested_ = false;
+		bool urgent_ = false;                  // ȴϲ, д
+		bool stop_ = false;
+
+		std::atomic<bool> subscribed_{ false };    // Ƿڶ
+		QStringList staged_;                       // δ޸, mutex
+		std::recursive_mutex subscribers_mutex_;   // , ֤ȡķغٻص
+		SubscriptionTree tree_;
+		QMap<int, Subscription> subscriptions_;
+		int next_id_ = 0;
+		std::thread notifier_;                     // ֪ͨ߳, ͬʱڼⲿ޸²ļ
+		std::mutex notifier_mutex_;
+		std::condition_variable notifier_cv_;
+		QVector<QStringList> batches_;             // ѷ֪ͨ޸
+		bool notifier_stop_ = false;
+
+		bool base_stale_ = false;                  // baseҪºϲ, mutex
+	};
+
 	struct Context {
-		inline Context()
-			: mutex(nullptr)
+		inline Context() {
+			counter = 0;
+		}
+
+		int counter;
+		std::shared_ptr<Store> store;
+	};
+	static std::map<QString, Context> file_lock;
+
+	void Histogram::add(quint64 nsecs)
+	{
+		int bucket = 0;
+		for (auto usecs = nsecs / 1000; usecs && bucket < IniHistogram::kBuckets - 1; usecs >>= 1) {
+			++bucket;
+		}
+
+		++buckets_[bucket];
+		++count_;
+		total_ += nsecs;
+		auto max = max_.load();
+		while (nsecs > max && !max_.compare_exchange_weak(max, nsecs)) {
+		}
+	}
+
+	void Histogram::snapshot(IniHistogram& h) const
+	{
+		h.count = count_;
+		h.total = total_;
+		h.max = max_;
+		for (int i = 0; i < IniHistogram::kBuckets; ++i) {
+			h.buckets[i] = buckets_[i];
+		}
+	}
+
+	void Histogram::reset()
+	{
+		count_ = 0;
+		total_ = 0;
+		max_ = 0;
+		for (auto& x : buckets_) {
+			x = 0;
+		}
+	}
+
+	void LockProfile::acquired(const char* site, quint64 waitNsecs)
+	{
+		if (depth_++ != 0) {
+			return;
+		}
+
+		wait_.add(waitNsecs);
+		site_ = site;
+		{
+			std::lock_guard<std::mutex> lock(sites_mutex_);
+			auto& x = sites_[site];
+			++x.count;
+			x.wait_total += waitNsecs;
+			x.wait_max = std::max<quint64>(x.wait_max, waitNsecs);
+		}
+		held_.start();
+	}
+
+	void LockProfile::releasing()
+	{
+		if (depth_ == 0 || --depth_ != 0) {
+			return;
+		}
+
+		auto nsecs = held_.nsecsElapsed();
+		hold_.add(nsecs);
+		std::lock_guard<std::mutex> lock(sites_mutex_);
+		sites_[site_].hold_total += nsecs;
+	}
+
+	void LockProfile::snapshot(IniLockStats& s) const
+	{
+		wait_.snapshot(s.wait);
+		hold_.snapshot(s.hold);
+
+		std::lock_guard<std::mutex> lock(sites_mutex_);
+		s.sites.clear();
+		s.sites.reserve(sites_.size());
+		for (auto it = sites_.cbegin(); it != sites_.cend(); ++it) {
+			IniLockStats::Site x;
+			x.name = QString::fromLatin1(it.key());
+			x.count = it->count;
+			x.waitTotal = it->wait_total;
+			x.waitMax = it->wait_max;
+			x.holdTotal = it->hold_total;
+			s.sites.append(x);
+		}
+		std::sort(s.sites.begin(), s.sites.end(), [](const IniLockStats::Site& a, const IniLockStats::Site& b) {
+			return a.waitTotal > b.waitTotal;
+			});
+	}
+
+	void LockProfile::reset()
+	{
+		wait_.reset();
+		hold_.reset();
+		std::lock_guard<std::mutex> lock(sites_mutex_);
+		sites_.clear();
+	}
+
+	template<typename View>
+	int NameTable::intern(View name)
+	{
+		auto id = find(name);
+		if (id != -1) {
+			return id;
+		}
+
+		if ((names_.size() + 1) * 2 > slots_.size()) {
+			rehash(std::max<int>(16, slots_.size() * 2));
+		}
+
+		id = names_.size();
+		auto h = hash(name);
+		names_.append(toString(name));
+		hashes_.append(h);
+		auto mask = slots_.size() - 1;
+		auto i = static_cast<int>(h & mask);
+		while (slots_[i] != -1) {
+			i = (i + 1) & mask;
+		}
+		slots_[i] = id;
+		return id;
+	}
+
+	template<typename View>
+	int NameTable::find(View name) const
+	{
+		if (slots_.isEmpty()) {
+			return -1;
+		}
+
+		auto h = hash(name);
+		auto mask = slots_.size() - 1;
+		for (auto i = static_cast<int>(h & mask); slots_[i] != -1; i = (i + 1) & mask) {
+			auto id = slots_[i];
+			if (hashes_[id] == h && equals(names_[id], name)) {
+				return id;
+			}
+		}
+		return -1;
+	}
+
+	template<typename View>
+	uint NameTable::hash(View name)
+	{
+		// FNV-1a, ַ۵Сд
+		uint h = 2166136261u;
+		for (auto c : name) {
+			h = (h ^ fold(QChar(c).unicode())) * 16777619u;
+		}
+		return h;
+	}
+
+	void NameTable::rehash(int capacity)
+	{
+		slots_.fill(-1, capacity);
+		auto mask = capacity - 1;
+		for (int id = 0; id < names_.size(); ++id) {
+			auto i = static_cast<int>(hashes_[id] & mask);
+			while (slots_[i] != -1) {
+				i = (i + 1) & mask;
+			}
+			slots_[i] = id;
+		}
+	}
+
+	void EntryIndex::insert(int name, int index)
+	{
+		if ((size_ + 1) * 2 > slots_.size()) {
+			reserve(size_ + 1);
+		}
+
+		auto mask = slots_.size() - 1;
+		auto i = slot(name, mask);
+		while (slots_[i].name != -1 && slots_[i].name != name) {
+			i = (i + 1) & mask;
+		}
+
+		if (slots_[i].name == -1) {
+			slots_[i].name = name;
+			++size_;
+		}
+		slots_[i].index = index;
+	}
+
+	void EntryIndex::reserve(int count)
+	{
+		auto capacity = std::max<int>(16, slots_.size());
+		while (capacity < count * 2) {
+			capacity *= 2;
+		}
+		if (capacity == slots_.size()) {
+			return;
+		}
+
+		auto old = std::move(slots_);
+		slots_ = QVector<Slot>(capacity);
+		size_ = 0;
+		for (const auto& x : old) {
+			if (x.name != -1) {
+				insert(x.name, x.index);
+			}
+		}
+	}
+
+	void NameTable::clear()
+	{
+		names_.clear();
+		hashes_.clear();
+		slots_.clear();
+	}
+
+	// ȥβĿհַ
+	static inline void trim(const char*& begin, const char*& end)
+	{
+		while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r' || *begin == '\v' || *begin == '\f')) {
+			++begin;
+		}
+		while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\v' || end[-1] == '\f')) {
+			--end;
+		}
+	}
+
+	// б[begin, end), ÿȥβĿհַ, 
+	template<typename Func>
+	static void forEachLine(const char* begin, const char* end, Func func)
+	{
+		while (begin < end) {
+			auto eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+			if (!eol) {
+				eol = end;
+			}
+
+			auto first = begin;
+			auto last = eol;
+			trim(first, last);
+			if (first < last) {
+				func(first, last);
+			}
+			begin = eol + 1;
+		}
+	}
+
+	// posеһпʼ'['ͷ, ׵λ, ʱsize
+	static int nextSectionLine(const char* data, int size, int pos)
+	{
+		while (pos < size) {
+			auto eol = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+			if (!eol) {
+				return size;
+			}
+
+			pos = static_cast<int>(eol - data) + 1;
+			auto i = pos;
+			while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\v' || data[i] == '\f')) {
+				++i;
+			}
+
+			if (i < size && data[i] == '[') {
+				return pos;
+			}
+		}
+		return size;
+	}
+
+	static inline bool isAscii(const char* data, int size)
+	{
+		for (int i = 0; i < size; ++i) {
+			if (static_cast<uchar>(data[i]) >= 0x80) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// УǷΪϷUTF-8, ڴ
+	static bool isUtf8(const QByteArray& data)
+	{
+		auto p = reinterpret_cast<const uchar*>(data.constData());
+		auto end = p + data.size();
+		while (p < end) {
+			if (*p < 0x80) {
+				++p;
+				continue;
+			}
+
+			int n = 0;
+			if ((*p & 0xe0) == 0xc0) {
+				n = 1;
+			}
+			else if ((*p & 0xf0) == 0xe0) {
+				n = 2;
+			}
+			else if ((*p & 0xf8) == 0xf0) {
+				n = 3;
+			}
+			else {
+				return false;
+			}
+
+			if (end - p <= n) {
+				return false;
+			}
+
+			for (int i = 1; i <= n; ++i) {
+				if ((p[i] & 0xc0) != 0x80) {
+					return false;
+				}
+			}
+			p += n + 1;
+		}
+		return true;
+	}
+
+	// ϲ²ϲ, ִСд, ²ǰ
+	static QStringList unite(const QStringList& lower, const QStringList& upper)
+	{
+		if (lower.isEmpty()) {
+			return upper;
+		}
+
+		auto result = lower;
+		QSet<QString> names;
+		for (const auto& x : lower) {
+			names.insert(x.toCaseFolded());
+		}
+		for (const auto& x : upper) {
+			auto folded = x.toCaseFolded();
+			if (!names.contains(folded)) {
+				names.insert(folded);
+				result.append(x);
+			}
+		}
+		return result;
+	}
+
+	// Ƚĵеļ, toĹϣfromеļ, ٷļ, ظļԵһγֵΪ׼.
+	// addedSectionsremovedSectionsΪʱͬʱ¼ֻһĽ
+	static void compare(const Document& from, const Document& to, QVector<IniDiff::Item>& added,
+		QVector<IniDiff::Item>& changed, QVector<IniDiff::Item>& removed,
+		QStringList* addedSections = nullptr, QStringList* removedSections = nullptr)
+	{
+		for (const auto& name : from.sectionNames()) {
+			auto s = from.section(name);
+			if (removedSections && !to.section(name)) {
+				removedSections->append(name);
+			}
+			for (int i = 0; i < s->entries.size(); ++i) {
+				const auto& e = s->entries[i];
+				if (e.key.isEmpty() || s->find(e.name) != i) {
+					continue;
+				}
+
+				auto x = to.entry(name, e.key);
+				if (!x) {
+					removed.append({ name, QString(e.key).replace('\\', '/'), QString() });
+				}
+				else if (!from.equals(e, to, *x)) {
+					changed.append({ name, QString(e.key).replace('\\', '/'), to.text(*x) });
+				}
+			}
+		}
+
+		for (const auto& name : to.sectionNames()) {
+			auto s = to.section(name);
+			auto exists = from.section(name) != nullptr;
+			if (addedSections && !exists) {
+				addedSections->append(name);
+			}
+			for (int i = 0; i < s->entries.size(); ++i) {
+				const auto& e = s->entries[i];
+				if (e.key.isEmpty() || s->find(e.name) != i) {
+					continue;
+				}
+
+				if (!exists || !from.entry(name, e.key)) {
+					added.append({ name, QString(e.key).replace('\\', '/'), to.text(e) });
+				}
+			}
+		}
+	}
+
+	// /\ּ·, յĲ㼶, ڴ
+	template<typename Func>
+	static void forEachSegment(QStringView path, Func func)
+	{
+		int begin = 0;
+		for (int i = 0; i <= path.size(); ++i) {
+			if (i == path.size() || path[i] == '/' || path[i] == '\\') {
+				if (i > begin) {
+					func(path.mid(begin, i - begin));
+				}
+				begin = i + 1;
+			}
+		}
+	}
+
+	void KeyTree::build(const QVector<Entry>& entries, NameTable& names)
+	{
+		nodes_.clear();
+		nodes_.append(Node());
+		for (const auto& x : entries) {
+			if (!x.key.isEmpty()) {
+				insert(x.key, names);
+			}
+		}
+		built_ = true;
+	}
+
+	// Ԫص, ʱ0
+	static int elementNumber(QStringView name)
+	{
+		if (name.isEmpty() || name.size() > 7 || name[0] == '0') {
+			return 0;
+		}
+
+		int number = 0;
+		for (auto c : name) {
+			if (c.unicode() < '0' || c.unicode() > '9') {
+				return 0;
+			}
+			number = number * 10 + (c.unicode() - '0');
+		}
+		return number;
+	}
+
+	void KeyTree::insert(QStringView key, NameTable& names)
+	{
+		int parent = -1;
+		int node = 0;
+		forEachSegment(key, [&](QStringView segment) {
+			if (parent != -1 && nodes_[node].children.isEmpty()) {
+				// һγΪ
+				addElement(parent, node);
+			}
+
+			auto name = names.intern(segment);
+			auto child = nodes_[node].index.value(name, -1);
+			if (child == -1) {
+				Node n;
+				n.name = name;
+				n.spelling = names.spelling(name, segment);
+				n.number = elementNumber(segment);
+				nodes_.append(n);
+				child = nodes_.size() - 1;
+				nodes_[node].children.append(child);
+				nodes_[node].index.insert(name, child);
+			}
+			parent = node;
+			node = child;
+			});
+
+		if (node != 0) {
+			nodes_[node].key = true;
+		}
+	}
+
+	void KeyTree::addElement(int parent, int child)
+	{
+		auto number = nodes_[child].number;
+		if (number == 0) {
+			return;
+		}
+
+		// Ԫͨŵд, ֱ׷; Ųظ, ʱelements[i] == i + 1ǰi + 1Ԫض
+		auto& p = nodes_[parent];
+		if (p.elements.isEmpty() || p.elements.last() < number) {
+			p.elements.append(number);
+		}
+		else {
+			p.elements.insert(std::lower_bound(p.elements.begin(), p.elements.end(), number), number);
+		}
+		while (p.contiguous < p.elements.size() && p.elements[p.contiguous] == p.contiguous + 1) {
+			++p.contiguous;
+		}
+	}
+
+	int KeyTree::find(QStringView path, const NameTable& names) const
+	{
+		if (nodes_.isEmpty()) {
+			return -1;
+		}
+
+		int node = 0;
+		forEachSegment(path, [&](QStringView segment) {
+			if (node != -1) {
+				node = nodes_[node].index.value(names.find(segment), -1);
+			}
+			});
+		return node;
+	}
+
+	void KeyTree::collect(int node, const QString& prefix, QStringList& result) const
+	{
+		for (auto x : nodes_[node].children) {
+			const auto& child = nodes_[x];
+			auto path = prefix.isEmpty() ? child.spelling : prefix + "/" + child.spelling;
+			if (child.key) {
+				result.append(path);
+			}
+			collect(x, path, result);
+		}
+	}
+
+	void Document::parse(const QByteArray& data, bool lazy)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		clear();
+
+		QByteArray bytes;
+		if (data.startsWith("\xff\xfe")) {
+			// UTF-16ڲUTF-8, дʱתUTF-16
+			codec_ = Codec::Utf16;
+			bytes = QString::fromUtf16(reinterpret_cast<const ushort*>(data.constData() + 2), (data.size() - 2) / 2).toUtf8();
+		}
+		else if (data.startsWith("\xef\xbb\xbf")) {
+			codec_ = Codec::Utf8Bom;
+			bytes = data.mid(3);
+		}
+		else {
+			// WritePrivateProfileStringһ, ļ봿ASCIIļANSIд,
+			// ֻѺASCIIַUTF-8ļUTF-8
+			bytes = data;
+			codec_ = !isAscii(bytes.constData(), bytes.size()) && isUtf8(bytes) ? Codec::Utf8 : Codec::Local8Bit;
+		}
+
+		// ļΪarena, ֵٵڴ, Ҳ
+		arena_.append(bytes);
+		if (!lazy && bytes.size() > kParallelThreshold && QThread::idealThreadCount() > 1) {
+			parseParallel(bytes);
+			return;
+		}
+
+		if (!lazy) {
+			parseText(bytes.constData(), bytes.constData() + bytes.size(), nullptr);
+			for (auto& x : sections_) {
+				x.reindex();
+			}
+			return;
+		}
+
+		// ֻɨڵı߽, '[''\n'UTF-8GBKȱжΪַֽֽڳ
+		raw_ = bytes;
+		auto p = raw_.constData();
+		auto size = raw_.size();
+		Section* current = nullptr;
+		int pos = 0;
+		while (pos < size) {
+			auto eol = raw_.indexOf('\n', pos);
+			if (eol == -1) {
+				eol = size;
+			}
+
+			auto i = pos;
+			while (i < eol && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r')) {
+				++i;
+			}
+
+			if (i < eol && p[i] == '[') {
+				if (current) {
+					current->ranges.last().second = pos;
+				}
+
+				auto end = i + 1;
+				while (end < eol && p[end] != ']') {
+					++end;
+				}
+
+				current = insertSection(decode(p + i + 1, end - i - 1).trimmed());
+				if (current->parsed && current->entries.isEmpty()) {
+					current->parsed = false;
+					++unparsed_;
+				}
+				current->ranges.append(qMakePair(std::min<int>(eol + 1, size), size));
+			}
+			pos = eol + 1;
+		}
+
+		if (unparsed_ == 0) {
+			raw_.clear();
+		}
+	}
+
+	QString Document::decode(const char* data, int size) const
+	{
+		return codec_ == Codec::Local8Bit ? QString::fromLocal8Bit(data, size) : QString::fromUtf8(data, size);
+	}
+
+	void Document::parseText(const char* begin, const char* end, Section* current)
+	{
+		// ֽڽ, '[', ']', '=', ';'UTF-8GBKȱжΪַֽһֳ
+		forEachLine(begin, end, [&](const char* first, const char* last) {
+			if (*first == '[') {
+				auto close = static_cast<const char*>(memchr(first, ']', last - first));
+				auto nameBegin = first + 1;
+				auto nameEnd = close ? close : last;
+				trim(nameBegin, nameEnd);
+				current = insertSection(decode(nameBegin, static_cast<int>(nameEnd - nameBegin)));
+				return;
+			}
+
+			if (!current) {
+				// һ֮ǰGetPrivateProfileStringҲ޷, ֱӺ
+				return;
+			}
+
+			Entry entry;
+			auto equal = *first != ';' ? static_cast<const char*>(memchr(first, '=', last - first)) : nullptr;
+			if (equal) {
+				auto keyBegin = first;
+				auto keyEnd = equal;
+				trim(keyBegin, keyEnd);
+				if (keyBegin < keyEnd) {
+					entry.name = intern(keyBegin, static_cast<int>(keyEnd - keyBegin), &entry.key);
+				}
+
+				auto valueBegin = equal + 1;
+				auto valueEnd = last;
+				trim(valueBegin, valueEnd);
+				borrow(valueBegin, valueEnd, entry);
+			}
+			else {
+				borrow(first, last, entry);
+			}
+			current->entries.append(entry);
+			});
+	}
+
+	void Document::parseParallel(const QByteArray& bytes)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		// ڵıֿ߽, ÿ'['ͷпʼ, һ֮ǰнʱһ
+		auto p = bytes.constData();
+		auto size = bytes.size();
+		auto count = std::min<int>(QThread::idealThreadCount(), size / kMinChunkSize);
+		QVector<QPair<int, int>> chunks;
+		int begin = 0;
+		for (int i = 1; i < count && begin < size; ++i) {
+			auto end = nextSectionLine(p, size, std::max<int>(begin, static_cast<int>(static_cast<qint64>(size) * i / count)));
+			if (end > begin) {
+				chunks.append(qMakePair(begin, end));
+				begin = end;
+			}
+		}
+		if (begin < size) {
+			chunks.append(qMakePair(begin, size));
+		}
+
+		// ĵ, ֱֵͬarena
+		QVector<Document> parts(chunks.size());
+		auto data = parts.data();
+		QVector<int> indexes;
+		for (int i = 0; i < chunks.size(); ++i) {
+			data[i].codec_ = codec_;
+			data[i].arena_.append(bytes);
+			indexes.append(i);
+		}
+		QtConcurrent::blockingMap(indexes, [&](int i) {
+			data[i].parseText(p + chunks[i].first, p + chunks[i].second, nullptr);
+			});
+
+		// ˳ϲ, ˳ظʱԵһγΪ׼Ĺнͬ
+		for (auto& x : parts) {
+			merge(x);
+		}
+
+		QtConcurrent::blockingMap(sections_, [](Section& s) {
+			s.reindex();
+			});
+	}
+
+	void Document::merge(Document& part)
+	{
+		// ƱֻڸԵƱЧ, ӳһ
+		QVector<int> ids(part.names_.size());
+		for (int i = 0; i < ids.size(); ++i) {
+			ids[i] = names_.intern(QStringView(part.names_.name(i)));
+		}
+
+		for (auto& x : part.sections_) {
+			for (auto& e : x.entries) {
+				if (e.name != -1) {
+					e.name = ids[e.name];
+					e.key = names_.spelling(e.name, QStringView(e.key));
+				}
+			}
+
+			auto s = insertSection(x.name);
+			if (s->entries.isEmpty()) {
+				s->entries.swap(x.entries);
+			}
+			else {
+				s->entries += x.entries;
+			}
+		}
+		live_ += part.live_;
+	}
+
+	int Document::intern(const char* data, int size, QString* spelling)
+	{
+		// ΪASCII, ֱӲ
+		if (isAscii(data, size)) {
+			QLatin1String name(data, size);
+			auto id = names_.intern(name);
+			*spelling = names_.spelling(id, name);
+			return id;
+		}
+
+		auto name = decode(data, size);
+		auto id = names_.intern(QStringView(name));
+		*spelling = names_.spelling(id, name);
+		return id;
+	}
+
+	void Document::parseSection(Section& s)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		if (s.parsed) {
+			return;
+		}
+
+		s.parsed = true;
+		for (const auto& x : s.ranges) {
+			// raw_ͬʱarena_, ͷraw_ֵȻЧ
+			parseText(raw_.constData() + x.first, raw_.constData() + x.second, &s);
+		}
+		s.ranges.clear();
+		s.reindex();
+
+		if (--unparsed_ == 0) {
+			raw_.clear();
+		}
+	}
+
+	void Document::borrow(const char* begin, const char* end, Entry& e)
+	{
+		if (begin == end) {
+			return;
+		}
+
+		// ʱarenaĵһ(raw_), ֻ¼λ, Ϊÿֵڴ
+		e.chunk = 0;
+		e.offset = static_cast<int>(begin - arena_.first().constData());
+		e.size = static_cast<int>(end - begin);
+		e.borrowed = true;
+		live_ += e.size;
+	}
+
+	void Document::release(Entry& e)
+	{
+		if (!e.borrowed) {
+			return;
+		}
+
+		e.borrowed = false;
+		live_ -= e.size;
+		dead_ += e.size;
+		e.size = 0;
+	}
+
+	const QString& Document::detach(Entry& e)
+	{
+		if (e.borrowed) {
+			auto value = text(e);
+			release(e);
+			e.value = value;
+			if (dead_ > kCompactThreshold && dead_ > live_) {
+				compact();
+			}
+		}
+		return e.value;
+	}
+
+	QString Document::text(const Entry& e) const
+	{
+		return e.borrowed ? decode(raw(e), e.size) : e.value;
+	}
+
+	bool Document::equals(const Entry& e, const Document& other, const Entry& x) const
+	{
+		if (e.borrowed && x.borrowed && codec_ == other.codec_) {
+			return e.size == x.size && memcmp(raw(e), other.raw(x), e.size) == 0;
+		}
+		return text(e) == other.text(x);
+	}
+
+	QByteArray Document::encode(const QString& text) const
+	{
+		// UTF-16ļڲUTF-8
+		return codec_ == Codec::Local8Bit ? text.toLocal8Bit() : text.toUtf8();
+	}
+
+	void Document::compact()
+	{
+		// ֻԱõֵ, , Ѹ, ɾƵֵһͷ
+		QByteArray arena;
+		arena.reserve(live_);
+		for (const auto& x : sections_) {
+			for (const auto& y : x.entries) {
+				if (y.borrowed) {
+					arena.append(raw(y), y.size);
+				}
+			}
+		}
+
+		// δĽʱraw_Ϊһ, ѹֵΪڶ
+		auto chunk = raw_.isEmpty() ? 0 : 1;
+		auto offset = 0;
+		for (auto& x : sections_) {
+			for (auto& y : x.entries) {
+				if (y.borrowed) {
+					y.chunk = chunk;
+					y.offset = offset;
+					offset += y.size;
+				}
+			}
+		}
+
+		arena_.clear();
+		if (!raw_.isEmpty()) {
+			// δĽ
+			arena_.append(raw_);
+		}
+		if (!arena.isEmpty()) {
+			arena_.append(arena);
+		}
+		dead_ = 0;
+	}
+
+	void Document::shrinkNames()
+	{
+		// ɾļ, Լ·еĸƲƱƳ,
+		// д벢ɾ̬ĽƱֻ. ʱ, ̯Ϊ
+		if (names_.size() < kNameCompactThreshold || names_.size() < named_ * 2) {
+			return;
+		}
+
+		NameTable names;
+		for (auto& x : sections_) {
+			x.id = names.intern(QStringView(x.name));
+			for (auto& y : x.entries) {
+				if (y.name != -1) {
+					y.name = names.intern(QStringView(y.key));
+				}
+			}
+			x.reindex();
+		}
+		names_ = std::move(names);
+		named_ = names_.size();
+		reindex();
+	}
+
+	Section* Document::insertSection(QStringView name)
+	{
+		auto id = names_.intern(name);
+		auto index = index_.value(id, -1);
+		if (index != -1) {
+			return &sections_[index];
+		}
+
+		Section s;
+		s.name = names_.spelling(id, name);
+		s.id = id;
+		sections_.append(s);
+		index_.insert(id, sections_.size() - 1);
+		return &sections_.last();
+	}
+
+	QByteArray Document::serialize() const
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		// ĵƴ, δ޸ĵֱֵӸԭʼֽ
+		QByteArray data;
+		for (const auto& x : sections_) {
+			if (!data.isEmpty()) {
+				data += "\r\n";
+			}
+			data += "[" + encode(x.name) + "]\r\n";
+			if (!x.parsed) {
+				// δʹĽԭ, 
+				for (const auto& y : x.ranges) {
+					forEachLine(raw_.constData() + y.first, raw_.constData() + y.second, [&data](const char* first, const char* last) {
+						data.append(first, static_cast<int>(last - first));
+						data += "\r\n";
+						});
+				}
+				continue;
+			}
+
+			for (const auto& y : x.entries) {
+				if (!y.key.isEmpty()) {
+					data += encode(y.key);
+					data += "=";
+				}
+				if (y.borrowed) {
+					data.append(raw(y), y.size);
+				}
+				else {
+					data += encode(y.value);
+				}
+				data += "\r\n";
+			}
+		}
+
+		switch (codec_)
+		{
+		case Codec::Utf16:
+		{
+			auto text = QString::fromUtf8(data);
+			return QByteArray("\xff\xfe", 2) + QByteArray(reinterpret_cast<const char*>(text.utf16()), text.size() * 2);
+		}
+		case Codec::Utf8Bom:
+			return "\xef\xbb\xbf" + data;
+		default:
+			return data;
+		}
+	}
+
+	void Document::clear()
+	{
+		sections_.clear();
+		names_.clear();
+		index_.clear();
+		codec_ = Codec::Local8Bit;
+		raw_.clear();
+		unparsed_ = 0;
+		named_ = 0;
+		arena_.clear();
+		live_ = 0;
+		dead_ = 0;
+	}
+
+	const Section* Document::section(QStringView name) const
+	{
+		auto index = index_.value(names_.find(name), -1);
+		if (index == -1) {
+			return nullptr;
+		}
+
+		// ĵֻڳStore::mutexʱ, ״ηʵĽǰȫ
+		auto self = const_cast<Document*>(this);
+		self->parseSection(self->sections_[index]);
+		return &sections_[index];
+	}
+
+	Section* Document::section(QStringView name, bool create)
+	{
+		auto index = index_.value(names_.find(name), -1);
+		if (index != -1) {
+			parseSection(sections_[index]);
+			return &sections_[index];
+		}
+		return create ? insertSection(name) : nullptr;
+	}
+
+	QStringList Document::sectionNames() const
+	{
+		QStringList result;
+		for (const auto& x : sections_) {
+			result.append(x.name);
+		}
+		return result;
+	}
+
+	const Entry* Document::entry(QStringView group, QStringView key) const
+	{
+		auto s = section(group);
+		if (!s) {
+			return nullptr;
+		}
+
+		auto index = s->find(names_.find(key));
+		return index != -1 ? &s->entries[index] : nullptr;
+	}
+
+	Entry* Document::entry(QStringView group, QStringView key)
+	{
+		auto s = section(group, false);
+		if (!s) {
+			return nullptr;
+		}
+
+		auto index = s->find(names_.find(key));
+		return index != -1 ? &s->entries[index] : nullptr;
+	}
+
+	bool Document::value(QStringView group, QStringView key, QString* value) const
+	{
+		auto e = entry(group, key);
+		if (!e) {
+			return false;
+		}
+
+		if (value) {
+			*value = text(*e);
+		}
+		return true;
+	}
+
+	void Document::setValue(QStringView group, QStringView key, const QString& value)
+	{
+		auto s = section(group, true);
+		auto name = names_.intern(key);
+		auto index = s->find(name);
+		if (index != -1) {
+			release(s->entries[index]);
+			s->entries[index].value = value;
+			s->entries[index].decrypted = false;
+		}
+		else {
+			Entry entry;
+			entry.key = names_.spelling(name, key);
+			entry.value = value;
+			entry.name = name;
+			s->entries.append(entry);
+			s->index.insert(name, s->entries.size() - 1);
+			if (s->tree.built()) {
+				s->tree.insert(key, names_);
+			}
+		}
+	}
+
+	bool Document::remove(QStringView group, QStringView key)
+	{
+		auto s = section(group, false);
+		if (!s) {
+			return false;
+		}
+
+		auto index = s->find(names_.find(key));
+		if (index == -1) {
+			return false;
+		}
+
+		release(s->entries[index]);
+		s->entries.removeAt(index);
+		s->reindex();
+		shrinkNames();
+		return true;
+	}
+
+	bool Document::removeSection(QStringView group)
+	{
+		auto index = index_.value(names_.find(group), -1);
+		if (index == -1) {
+			return false;
+		}
+
+		if (!sections_[index].parsed && --unparsed_ == 0) {
+			raw_.clear();
+		}
+		for (auto& x : sections_[index].entries) {
+			release(x);
+		}
+		sections_.removeAt(index);
+		reindex();
+		shrinkNames();
+		return true;
+	}
+
+	bool Document::removePath(QStringView group, QStringView path)
+	{
+		auto s = section(group, false);
+		if (!s || path.isEmpty()) {
+			return false;
+		}
+
+		auto prefix = path.toString().replace('/', '\\') + '\\';
+		int count = 0;
+		for (int i = 0; i < s->entries.size(); ++i) {
+			auto& x = s->entries[i];
+			if (!x.key.isEmpty() && x.key.startsWith(prefix, Qt::CaseInsensitive)) {
+				release(x);
+				continue;
+			}
+
+			if (count != i) {
+				s->entries[count] = std::move(x);
+			}
+			++count;
+		}
+
+		if (count == s->entries.size()) {
+			return false;
+		}
+
+		s->entries.resize(count);
+		s->reindex();
+		shrinkNames();
+		return true;
+	}
+
+	int Document::movePath(QStringView group, QStringView path, QStringView toGroup, QStringView toPath,
+		Ini::Conflict conflict, QVector<QPair<QString, QString>>* moved)
+	{
+		auto s = section(group, false);
+		if (!s) {
+			return 0;
+		}
+
+		auto from = path.toString().replace('/', '\\');
+		auto to = toPath.toString().replace('/', '\\');
+		auto sameGroup = names_.find(group) == names_.find(toGroup);
+		if (sameGroup) {
+			if (QString::compare(from, to, Qt::CaseInsensitive) == 0) {
+				return 0;
+			}
+
+			if (from.isEmpty() || to.startsWith(from + '\\', Qt::CaseInsensitive)) {
+				// ƶ֮
+				return -1;
+			}
+		}
+
+		struct Move {
+			int index;                 // Դentriesе±
+			QString key;               // ¼
+			bool exists;               // ¼Ѵ
+		};
+
+		// ҳҪƶļ¼
+		QVector<Move> moves;
+		QSet<int> sources;             // Ҫߵļ, ͬһƶʱĿ֮һ
+		for (int i = 0; i < s->entries.size(); ++i) {
+			const auto& x = s->entries[i];
+			if (x.key.isEmpty()) {
+				continue;
+			}
+
+			QString key;
+			if (from.isEmpty()) {
+				key = to.isEmpty() ? x.key : to + '\\' + x.key;
+			}
+			else if (QString::compare(x.key, from, Qt::CaseInsensitive) == 0) {
+				key = to;
+			}
+			else if (x.key.size() > from.size() && x.key[from.size()] == '\\' && x.key.startsWith(from, Qt::CaseInsensitive)) {
+				key = to.isEmpty() ? x.key.mid(from.size() + 1) : to + x.key.mid(from.size());
+			}
+
+			if (!key.isEmpty()) {
+				moves.append({ i, key, false });
+				sources.insert(x.name);
+			}
+		}
+
+		if (moves.isEmpty()) {
+			return 0;
+		}
+
+		auto target = sameGroup ? s : section(toGroup, false);
+		if (target) {
+			for (auto& x : moves) {
+				auto name = names_.find(QStringView(x.key));
+				x.exists = target->find(name) != -1 && !(sameGroup && sources.contains(name));
+				if (x.exists && conflict == Ini::Conflict::Abort) {
+					return -1;
+				}
+			}
+		}
+
+		// ԴȡҪƶĿ, Ŀԭ
+		QVector<Entry> taken;
+		taken.reserve(moves.size());
+		int count = 0;
+		int next = 0;
+		for (int i = 0; i < s->entries.size(); ++i) {
+			auto& x = s->entries[i];
+			if (next < moves.size() && moves[next].index == i) {
+				const auto& m = moves[next++];
+				if (!m.exists || conflict == Ini::Conflict::Overwrite) {
+					if (moved) {
+						moved->append(qMakePair(x.key, m.key));
+					}
+					x.name = names_.intern(QStringView(m.key));
+					x.key = names_.spelling(x.name, m.key);
+					taken.append(std::move(x));
+					continue;
+				}
+			}
+
+			if (count != i) {
+				s->entries[count] = std::move(x);
+			}
+			++count;
+		}
+		s->entries.resize(count);
+		s->reindex();
+
+		auto empty = from.isEmpty() && std::none_of(s->entries.begin(), s->entries.end(), [](const Entry& x) {
+			return !x.key.isEmpty();
+			});
+
+		// ĿڿʹsʧЧ
+		auto dest = section(toGroup, true);
+		if (conflict == Ini::Conflict::Overwrite) {
+			// Ŀ·滻ΪԴ, Դϲ, ʱԪ. ͬһڵԴѾȡ, Ӱ
+			auto prefix = to + '\\';
+			int count = 0;
+			for (int i = 0; i < dest->entries.size(); ++i) {
+				auto& x = dest->entries[i];
+				if (!x.key.isEmpty() && (to.isEmpty() || QString::compare(x.key, to, Qt::CaseInsensitive) == 0 ||
+					x.key.startsWith(prefix, Qt::CaseInsensitive))) {
+					release(x);
+					continue;
+				}
+
+				if (count != i) {
+					dest->entries[count] = std::move(x);
+				}
+				++count;
+			}
+
+			if (count != dest->entries.size()) {
+				dest->entries.resize(count);
+				dest->reindex();
+			}
+		}
+
+		for (auto& x : taken) {
+			auto index = dest->find(x.name);
+			if (index != -1) {
+				release(dest->entries[index]);
+				dest->entries[index] = std::move(x);
+			}
+			else {
+				dest->entries.append(std::move(x));
+				dest->index.insert(dest->entries.last().name, dest->entries.size() - 1);
+			}
+		}
+		dest->tree.invalidate();
+
+		if (empty) {
+			// , ֻʣע͵ԭ
+			removeSection(group);
+		}
+		shrinkNames();
+		return taken.size();
+	}
+
+	void Document::reindex()
+	{
+		index_.clear();
+		for (int i = 0; i < sections_.size(); ++i) {
+			index_.insert(sections_[i].id, i);
+		}
+	}
+
+	int Document::arraySize(QStringView group, QStringView path) const
+	{
+		auto t = tree(group);
+		auto node = t ? t->find(path, names_) : -1;
+		if (node == -1 || t->node(node).contiguous == 0) {
+			return -1;
+		}
+
+		QString size;
+		if (!value(group, path.toString().replace('/', '\\') + "\\size", &size)) {
+			return -1;
+		}
+
+		auto result = size.toInt();
+		return result > 0 && t->node(node).contiguous >= result ? result : -1;
+	}
+
+	bool Document::isGroup(QStringView group, QStringView path) const
+	{
+		auto t = tree(group);
+		auto node = t ? t->find(path, names_) : -1;
+		if (node == -1 || path.isEmpty()) {
+			return false;
+		}
+
+		const auto& n = t->node(node);
+		if (n.children.isEmpty()) {
+			return false;
+		}
+
+		// ͬʱеһԪsizeʱΪ
+		auto size = n.index.value(names_.find(QLatin1String("size")), -1);
+		return n.elements.isEmpty() || n.elements[0] != 1 || size == -1 || !t->node(size).key;
+	}
+
+	const KeyTree* Document::tree(QStringView group) const
+	{
+		auto s = section(group);
+		if (!s) {
+			return nullptr;
+		}
+
+		if (!s->tree.built()) {
+			// sectionͬ, ĵֻڳStore::mutexʱ, ״гʱ
+			auto self = const_cast<Document*>(this);
+			const_cast<Section*>(s)->tree.build(s->entries, self->names_);
+		}
+		return &s->tree;
+	}
+
+	QStringList Document::children(QStringView group, QStringView path, bool groups) const
+	{
+		QStringList result;
+		auto t = tree(group);
+		auto node = t ? t->find(path, names_) : -1;
+		if (node == -1) {
+			return result;
+		}
+
+		const auto& children = t->node(node).children;
+		result.reserve(children.size());
+		for (auto x : children) {
+			const auto& child = t->node(x);
+			if (groups ? !child.children.isEmpty() : child.key) {
+				result.append(child.spelling);
+			}
+		}
+		return result;
+	}
+
+	QStringList Document::keys(QStringView group, QStringView path) const
+	{
+		QStringList result;
+		auto t = tree(group);
+		auto node = t ? t->find(path, names_) : -1;
+		if (node != -1) {
+			t->collect(node, QString(), result);
+		}
+		return result;
+	}
+
+	FileLock::FileLock(const QString& path)
+		: path_(path)
+	{
+	}
+
+	FileLock::~FileLock()
+	{
+		if (handle_ != INVALID_HANDLE_VALUE) {
+			::CloseHandle(handle_);
+			handle_ = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	bool FileLock::lock(Mode mode, int timeout, bool user)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout < 0 ? 0 : timeout);
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			if (!busy_) {
+				if (count_ == 0) {
+					break;
+				}
+
+				if (mode_ == Mode::Exclusive || mode == Mode::Shared) {
+					++count_;
+					user_ += user ? 1 : 0;
+					return true;
+				}
+
+				// ûйʱ޷Ϊռ, ȴֻ
+				if (user_ > 0) {
+					return false;
+				}
+			}
+
+			if (timeout < 0) {
+				cv_.wait(lock);
+			}
+			else if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+				return false;
+			}
+		}
+
+		busy_ = true;
+		lock.unlock();
+		auto remaining = timeout;
+		if (timeout > 0) {
+			remaining = static_cast<int>(std::max<qint64>(0, std::chrono::duration_cast<std::chrono::milliseconds>(
+				deadline - std::chrono::steady_clock::now()).count()));
+		}
+		auto result = acquire(mode, remaining);
+		lock.lock();
+		busy_ = false;
+		if (result) {
+			mode_ = mode;
+			count_ = 1;
+			user_ = user ? 1 : 0;
+		}
+		cv_.notify_all();
+		return result;
+	}
+
+	bool FileLock::unlock(bool user)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (count_ == 0 || (user && user_ == 0)) {
+			return false;
+		}
+
+		user_ -= user ? 1 : 0;
+		if (--count_ == 0) {
+			OVERLAPPED ov{};
+			::UnlockFileEx(handle_, 0, MAXDWORD, MAXDWORD, &ov);
+			cv_.notify_all();
+		}
+		return true;
+	}
+
+	bool FileLock::acquire(Mode mode, int timeout)
+	{
+		if (handle_ == INVALID_HANDLE_VALUE) {
+			handle_ = ::CreateFileW(reinterpret_cast<LPCWSTR>(path_.utf16()), GENERIC_READ | GENERIC_WRITE,
+				FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+			if (handle_ == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+		}
+
+		DWORD flags = mode == Mode::Exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0;
+		if (timeout == 0) {
+			flags |= LOCKFILE_FAIL_IMMEDIATELY;
+		}
+
+		OVERLAPPED ov{};
+		ov.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		auto result = ::LockFileEx(handle_, flags, 0, MAXDWORD, MAXDWORD, &ov);
+		if (!result && ::GetLastError() == ERROR_IO_PENDING) {
+			DWORD bytes = 0;
+			if (::WaitForSingleObject(ov.hEvent, timeout < 0 ? INFINITE : timeout) == WAIT_OBJECT_0) {
+				result = ::GetOverlappedResult(handle_, &ov, &bytes, FALSE);
+			}
+			else {
+				// ȡȴ, ȡɹͬʱ, սΪ׼
+				::CancelIoEx(handle_, &ov);
+				result = ::GetOverlappedResult(handle_, &ov, &bytes, TRUE);
+			}
+		}
+		::CloseHandle(ov.hEvent);
+		return result == TRUE;
+	}
+
+	Store::Store(const QString& iniFile, const QString& commentFile)
+		: file_lock(iniFile + ".lock")
+	{
+		ini.path = iniFile;
+		ini.journal = iniFile + ".journal";
+		comment.path = commentFile;
+		comment.journal = commentFile + ".journal";
+	}
+
+	Store::~Store()
+	{
+		{
+			std::lock_guard<std::mutex> lock(flusher_mutex_);
+			stop_ = true;
+		}
+		flusher_cv_.notify_all();
+		if (flusher_.joinable()) {
+			flusher_.join();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(notifier_mutex_);
+			notifier_stop_ = true;
+		}
+		notifier_cv_.notify_all();
+		if (notifier_.joinable()) {
+			notifier_.join();
+		}
+	}
+
+	File& Store::file(const QString& path)
+	{
+		return path == ini.path ? ini : comment;
+	}
+
+	bool Store::load(File& f)
+	{
+		auto locked = false;
+		if (locking) {
+			locked = file_lock.lock(FileLock::Mode::Shared, lock_timeout);
+			if (!locked) {
+				// ȡʱ, ǰ, Ժٴγ
+				if (!f.loaded) {
+					f.doc.clear();
+					f.exists = false;
+					f.size = -1;
+					f.modified = QDateTime();
+					f.loaded = true;
+				}
+				f.checked.start();
+				return false;
+			}
+		}
+
+		if (subscribed_ && &f == &ini && f.loaded) {
+			// ¼, ̵֪ͨ޸
+			auto before = std::move(f.doc);
+			read(f, f.doc);
+			record(before, f.doc);
+			publish();
+		}
+		else {
+			read(f, f.doc);
+		}
+		f.checked.start();
+		f.loaded = true;
+		++f.version;
+
+		if (locked) {
+			file_lock.unlock();
+		}
+		return true;
+	}
+
+	void Store::refresh(File& f)
+	{
+		if (&f == &ini && !layers.isEmpty()) {
+			refreshLayers();
+		}
+
+		if (!f.loaded) {
+			++stats.cache_misses;
+			load(f);
+			return;
+		}
+
+		// δд̵޸ʱڴΪ׼
+		if (f.flushed < f.generation) {
+			++stats.cache_hits;
+			return;
+		}
+
+		if (f.checked.isValid() && f.checked.elapsed() < kRefreshInterval) {
+			++stats.cache_hits;
+			return;
+		}
+		f.checked.start();
+
+		if (changed(f)) {
+			++stats.cache_misses;
+			load(f);
+		}
+		else {
+			++stats.cache_hits;
+		}
+	}
+
+	void Store::setLayers(const QStringList& paths)
+	{
+		layers.clear();
+		for (const auto& x : paths) {
+			File f;
+			f.path = x;
+			f.journal = x + ".journal";
+			layers.append(f);
+		}
+		base.clear();
+		base_stale_ = !layers.isEmpty();
+
+		// ²ļ̶֪ͨ߳ڼ, ȡʱʴ
+		if (!layers.isEmpty()) {
+			std::lock_guard<std::mutex> notifier(notifier_mutex_);
+			if (!notifier_.joinable()) {
+				notifier_ = std::thread(&Store::watch, this);
+			}
+		}
+	}
+
+	void Store::refreshLayers()
+	{
+		// ²ļpollLayers֪ͨ߳м, ﲻʴ
+		if (!base_stale_) {
+			return;
+		}
+
+		// ֻ¶ȡδػѱ޸ĵļ
+		QVector<File*> reload;
+		for (auto& x : layers) {
+			if (!x.loaded) {
+				reload.append(&x);
+			}
+		}
+		stats.cache_misses += reload.size();
+
+		// ļ, ̳߳вжȡ. ²ļֻ, ʹÿļ
+		if (reload.size() > 1) {
+			QtConcurrent::blockingMap(reload, [this](File* f) {
+				read(*f, f->doc);
+				});
+		}
+		else if (!reload.isEmpty()) {
+			read(*reload[0], reload[0]->doc);
+		}
+
+		for (auto x : reload) {
+			x->checked.start();
+			x->loaded = true;
+			++x->version;
+		}
+
+		// ӵ͵θ, ͬһļظļԵһγֵΪ׼
+		INI_TRACE_SCOPE("mergeLayers");
+		base.clear();
+		for (int layer = 0; layer < layers.size(); ++layer) {
+			auto& x = layers[layer];
+			for (const auto& name : x.doc.sectionNames()) {
+				auto s = x.doc.section(name);
+				for (int i = 0; i < s->entries.size(); ++i) {
+					const auto& e = s->entries[i];
+					if (!e.key.isEmpty() && s->find(e.name) == i) {
+						base.setValue(name, e.key, x.doc.text(e));
+						base.entry(name, e.key)->origin = layer;
+					}
+				}
+			}
+		}
+		base_stale_ = false;
+	}
+
+	void Store::pollLayers()
+	{
+		// Ƹ·ʱ״̬, ڲmutexʱ, ȡ
+		QVector<File> snapshot;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			snapshot.reserve(layers.size());
+			for (const auto& x : layers) {
+				File s;
+				s.path = x.path;
+				s.journal = x.journal;
+				s.loaded = x.loaded;
+				s.exists = x.exists;
+				s.size = x.size;
+				s.modified = x.modified;
+				s.journal_size = x.journal_size;
+				s.journal_modified = x.journal_modified;
+				s.version = x.version;
+				snapshot.append(s);
+			}
+		}
+
+		QVector<int> stale;
+		for (int i = 0; i < snapshot.size(); ++i) {
+			if (snapshot[i].loaded && changed(snapshot[i])) {
+				stale.append(i);
+			}
+		}
+
+		if (stale.isEmpty()) {
+			return;
+		}
+
+		// ڼ²㱻滻¼صĲٱ
+		std::lock_guard<std::mutex> lock(mutex);
+		if (layers.size() != snapshot.size()) {
+			return;
+		}
+
+		for (auto i : stale) {
+			auto& x = layers[i];
+			if (x.path == snapshot[i].path && x.version == snapshot[i].version) {
+				x.loaded = false;
+				base_stale_ = true;
+			}
+		}
+	}
+
+	void Store::setValue(File& f, const QString& group, const QString& key, const QString& value)
+	{
+		if (subscribed_ && &f == &ini) {
+			auto e = f.doc.entry(group, key);
+			if (!e || f.doc.text(*e) != value) {
+				record(group, key);
+			}
+		}
+
+		Change change{ Change::Type::Set, group, key, value };
+		apply(f.doc, change);
+		f.pending.append(change);
+		++f.generation;
+	}
+
+	bool Store::addSection(File& f, const QString& group)
+	{
+		if (f.doc.section(group)) {
+			return false;
+		}
+
+		// սûм, ֪ͨ
+		Change change{ Change::Type::AddSection, group, QString(), QString() };
+		apply(f.doc, change);
+		f.pending.append(change);
+		++f.generation;
+		return true;
+	}
+
+	bool Store::remove(File& f, const QString& group, const QString& key)
+	{
+		Change change{ key.isEmpty() ? Change::Type::RemoveSection : Change::Type::Remove, group, key, QString() };
+		if (subscribed_ && &f == &ini) {
+			if (key.isEmpty()) {
+				auto s = f.doc.section(group);
+				if (s) {
+					for (const auto& x : s->entries) {
+						if (!x.key.isEmpty()) {
+							record(group, x.key);
+						}
+					}
+				}
+			}
+			else if (f.doc.entry(group, key)) {
+				record(group, key);
+			}
+		}
+		auto result = key.isEmpty() ? f.doc.removeSection(group) : f.doc.remove(group, key);
+		if (result) {
+			f.pending.append(change);
+			++f.generation;
+		}
+		return result;
+	}
+
+	int Store::movePath(File& f, const QString& group, const QString& path, const QString& toGroup, const QString& toPath,
+		Ini::Conflict conflict, QVector<QPair<QString, QString>>* moved)
+	{
+		Change change{ Change::Type::Move, group, path, QString(), toGroup, toPath, conflict };
+		if (subscribed_ && &f == &ini && conflict == Ini::Conflict::Overwrite) {
+			// Ŀ·ԭеļᱻɾ, ƶʧʱֻ֪ͨǶ, ©
+			if (f.doc.entry(toGroup, toPath)) {
+				record(toGroup, toPath);
+			}
+			for (const auto& x : f.doc.keys(toGroup, toPath)) {
+				record(toGroup, toPath.isEmpty() ? x : toPath + "\\" + x);
+			}
+		}
+
+		QVector<QPair<QString, QString>> keys;
+		auto result = f.doc.movePath(group, path, toGroup, toPath, conflict, &keys);
+		if (moved) {
+			*moved = keys;
+		}
+
+		if (result > 0) {
+			if (subscribed_ && &f == &ini) {
+				for (const auto& x : keys) {
+					record(group, x.first);
+					record(toGroup, x.second);
+				}
+			}
+			f.pending.append(change);
+			++f.generation;
+		}
+		return result;
+	}
+
+	bool Store::removePath(File& f, const QString& group, const QString& path)
+	{
+		Change change{ Change::Type::RemovePath, group, path, QString() };
+		if (subscribed_ && &f == &ini) {
+			for (const auto& x : f.doc.keys(group, path)) {
+				record(group, path + "\\" + x);
+			}
+		}
+		auto result = f.doc.removePath(group, path);
+		if (result) {
+			f.pending.append(change);
+			++f.generation;
+		}
+		return result;
+	}
+
+	QStringList SubscriptionTree::split(const QString& path)
+	{
+		auto segments = QString(path).replace('\\', '/').split('/', QString::SkipEmptyParts);
+		for (auto& x : segments) {
+			x = x.toCaseFolded();
+		}
+		return segments;
+	}
+
+	void SubscriptionTree::insert(const QString& prefix, int id)
+	{
+		auto node = &root_;
+		for (const auto& x : split(prefix)) {
+			auto& child = node->children[x];
+			if (!child) {
+				child.reset(new Node);
+			}
+			node = child.get();
+		}
+		node->ids.append(id);
+	}
+
+	void SubscriptionTree::remove(const QString& prefix, int id)
+	{
+		remove(root_, split(prefix), 0, id);
+	}
+
+	bool SubscriptionTree::remove(Node& node, const QStringList& segments, int depth, int id)
+	{
+		if (depth == segments.size()) {
+			node.ids.removeOne(id);
+		}
+		else {
+			auto it = node.children.find(segments[depth]);
+			if (it != node.children.end() && remove(*it->second, segments, depth + 1, id)) {
+				node.children.erase(it);
+			}
+		}
+
+		// Ƿɾ˽ڵ
+		return node.ids.isEmpty() && node.children.empty();
+	}
+
+	template<typename Func>
+	void SubscriptionTree::match(const QString& path, Func func) const
+	{
+		auto node = &root_;
+		for (auto id : node->ids) {
+			func(id);
+		}
+
+		for (const auto& x : split(path)) {
+			auto it = node->children.find(x);
+			if (it == node->children.end()) {
+				return;
+			}
+
+			node = it->second.get();
+			for (auto id : node->ids) {
+				func(id);
+			}
+		}
+	}
+
+	void Store::record(const QString& group, const QString& key)
+	{
+		// Generalļͨvalue("key")ʱһ, 
+		auto path = QString(key).replace('\\', '/');
+		staged_.append(group.compare("General", Qt::CaseInsensitive) == 0 ? path : group + "/" + path);
+	}
+
+	void Store::record(const Document& before, const Document& after)
+	{
+		// ޸ĵļ
+		for (const auto& name : after.sectionNames()) {
+			auto s = after.section(name);
+			for (const auto& x : s->entries) {
+				if (x.key.isEmpty() || after.entry(name, x.key) != &x) {
+					continue;
+				}
+
+				auto old = before.entry(name, x.key);
+				if (!old || before.text(*old) != after.text(x)) {
+					record(name, x.key);
+				}
+			}
+		}
+
+		// ɾļ
+		for (const auto& name : before.sectionNames()) {
+			auto s = before.section(name);
+			for (const auto& x : s->entries) {
+				if (!x.key.isEmpty() && !after.entry(name, x.key)) {
+					record(name, x.key);
+				}
+			}
+		}
+	}
+
+	void Store::publish()
+	{
+		if (staged_.isEmpty()) {
+			return;
+		}
+
+		staged_.removeDuplicates();
+		{
+			std::lock_guard<std::mutex> lock(notifier_mutex_);
+			batches_.append(staged_);
+		}
+		staged_.clear();
+		notifier_cv_.notify_all();
+	}
+
+	int Store::subscribe(const Ini* owner, const QString& prefix, IniChangeCb callback)
+	{
+		std::lock_guard<std::recursive_mutex> lock(subscribers_mutex_);
+		auto id = ++next_id_;
+		subscriptions_.insert(id, { owner, prefix, callback });
+		tree_.insert(prefix, id);
+		subscribed_ = true;
+
+		std::lock_guard<std::mutex> notifier(notifier_mutex_);
+		if (!notifier_.joinable()) {
+			notifier_ = std::thread(&Store::watch, this);
+		}
+		return id;
+	}
+
+	void Store::unsubscribe(const Ini* owner, int id)
+	{
+		std::lock_guard<std::recursive_mutex> lock(subscribers_mutex_);
+		auto it = subscriptions_.find(id);
+		if (it == subscriptions_.end() || it->owner != owner) {
+			return;
+		}
+
+		tree_.remove(it->prefix, id);
+		subscriptions_.erase(it);
+		subscribed_ = !subscriptions_.isEmpty();
+	}
+
+	void Store::unsubscribe(const Ini* owner)
+	{
+		std::lock_guard<std::recursive_mutex> lock(subscribers_mutex_);
+		for (auto it = subscriptions_.begin(); it != subscriptions_.end();) {
+			if (it->owner == owner) {
+				tree_.remove(it->prefix, it.key());
+				it = subscriptions_.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		subscribed_ = !subscriptions_.isEmpty();
+	}
+
+	void Store::watch()
+	{
+		std::unique_lock<std::mutex> lock(notifier_mutex_);
+		for (;;) {
+			auto pred = [this] { return notifier_stop_ || !batches_.isEmpty(); };
+			if (!notifier_cv_.wait_for(lock, std::chrono::milliseconds(kWatchInterval), pred)) {
+				// ûб̵޸, ļǷ޸, ֺload֪ͨ
+				lock.unlock();
+				pollLayers();
+				if (subscribed_) {
+					std::lock_guard<std::mutex> doc(mutex);
+					refresh(ini);
+				}
+				lock.lock();
+				continue;
+			}
+
+			if (notifier_stop_) {
+				break;
+			}
+
+			auto batches = std::move(batches_);
+			batches_.clear();
+			lock.unlock();
+			for (const auto& x : batches) {
+				dispatch(x);
+			}
+			lock.lock();
+		}
+	}
+
+	void Store::dispatch(const QStringList& keys)
+	{
+		std::lock_guard<std::recursive_mutex> lock(subscribers_mutex_);
+		QMap<int, QStringList> matched;    // ı -> ƥļ, ĵȺص
+		for (const auto& x : keys) {
+			tree_.match(x, [&matched, &x](int id) {
+				matched[id].append(x);
+				});
+		}
+
+		for (auto it = matched.cbegin(); it != matched.cend(); ++it) {
+			// ֮ǰĻصȡ˶
+			auto s = subscriptions_.constFind(it.key());
+			if (s != subscriptions_.cend() && s->callback) {
+				auto callback = s->callback;
+				callback(it.value());
+			}
+		}
+	}
+
+	void Store::apply(Document& doc, const Change& change)
+	{
+		switch (change.type)
 		{
-			counter = 0;
-			mutex = std::make_unique<std::mutex>();
+		case Change::Type::Set:
+			doc.setValue(change.group, change.key, change.value);
+			break;
+		case Change::Type::Remove:
+			doc.remove(change.group, change.key);
+			break;
+		case Change::Type::RemoveSection:
+			doc.removeSection(change.group);
+			break;
+		case Change::Type::RemovePath:
+			doc.removePath(change.group, change.key);
+			break;
+		case Change::Type::AddSection:
+			doc.section(change.group, true);
+			break;
+		case Change::Type::Move:
+			doc.movePath(change.group, change.key, change.target_group, change.target_key, change.conflict, nullptr);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// ˢļĿ¼, Windowsֻ֧FILE_FLAG_BACKUP_SEMANTICSĿ¼, Ϊ
+	static void syncDir(const QString& path)
+	{
+		auto dir = QDir::toNativeSeparators(QFileInfo(path).absolutePath());
+		auto handle = ::CreateFileW(reinterpret_cast<LPCWSTR>(dir.utf16()), GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+		if (handle != INVALID_HANDLE_VALUE) {
+			::FlushFileBuffers(handle);
+			::CloseHandle(handle);
+		}
+	}
+
+	// дļ, ݳ־ûѡֱӸǻдʱļԭ滻
+	static bool writeFile(const QString& path, const QByteArray& data, Ini::Durability durability)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		if (durability == Ini::Durability::None) {
+			QFile file(path);
+			auto result = file.open(QFile::WriteOnly | QFile::Truncate) && file.write(data) == data.size();
+			file.close();
+			return result;
+		}
+
+		// ʱļĿļλͬһĿ¼, ֤MoveFileExΪͬڵԭ滻
+		auto temp = QDir::toNativeSeparators(path + QString(".%1.tmp").arg(::GetCurrentProcessId()));
+		auto target = QDir::toNativeSeparators(path);
+		auto handle = ::CreateFileW(reinterpret_cast<LPCWSTR>(temp.utf16()), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		DWORD bytes = 0;
+		auto result = ::WriteFile(handle, data.constData(), static_cast<DWORD>(data.size()), &bytes, nullptr) &&
+			bytes == static_cast<DWORD>(data.size());
+		if (result && durability >= Ini::Durability::Fsync) {
+			result = ::FlushFileBuffers(handle);
+		}
+		::CloseHandle(handle);
+
+		if (result) {
+			DWORD flags = MOVEFILE_REPLACE_EXISTING;
+			if (durability >= Ini::Durability::Fsync) {
+				flags |= MOVEFILE_WRITE_THROUGH;
+			}
+
+			// ڶȡĿļʱ滻ʧ, 
+			result = FALSE;
+			for (int i = 0; i < 10 && !result; ++i) {
+				result = ::MoveFileExW(reinterpret_cast<LPCWSTR>(temp.utf16()), reinterpret_cast<LPCWSTR>(target.utf16()), flags);
+				if (!result) {
+					::Sleep(10);
+				}
+			}
+		}
+
+		if (!result) {
+			::DeleteFileW(reinterpret_cast<LPCWSTR>(temp.utf16()));
+			return false;
+		}
+
+		if (durability == Ini::Durability::FsyncDir) {
+			syncDir(path);
+		}
+		return true;
+	}
+
+	// ׷д־, д;ֻһ¼, ʱᱻ
+	static bool appendFile(const QString& path, const QByteArray& data, Ini::Durability durability)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		auto native = QDir::toNativeSeparators(path);
+		auto handle = ::CreateFileW(reinterpret_cast<LPCWSTR>(native.utf16()), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr,
+			OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		auto created = ::GetLastError() != ERROR_ALREADY_EXISTS;
+		DWORD bytes = 0;
+		auto result = ::WriteFile(handle, data.constData(), static_cast<DWORD>(data.size()), &bytes, nullptr) &&
+			bytes == static_cast<DWORD>(data.size());
+		if (result && durability >= Ini::Durability::Fsync) {
+			result = ::FlushFileBuffers(handle);
+		}
+		::CloseHandle(handle);
+
+		if (result && created && durability == Ini::Durability::FsyncDir) {
+			syncDir(path);
+		}
+		return result;
+	}
+
+	// INIļݵժҪ, ϲ־ʱ¼־
+	static QByteArray digest(const QByteArray& data)
+	{
+		return QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex();
+	}
+
+	// ־¼еֶ\tָ, ¼\n
+	static QString escapeRecord(const QString& str)
+	{
+		QString result;
+		result.reserve(str.size());
+		for (auto c : str) {
+			switch (c.unicode())
+			{
+			case '\\':
+				result += "\\\\";
+				break;
+			case '\t':
+				result += "\\t";
+				break;
+			case '\n':
+				result += "\\n";
+				break;
+			case '\r':
+				result += "\\r";
+				break;
+			default:
+				result += c;
+				break;
+			}
+		}
+		return result;
+	}
+
+	static QString unescapeRecord(const QStringRef& str)
+	{
+		QString result;
+		result.reserve(str.size());
+		for (int i = 0; i < str.size(); ++i) {
+			auto c = str.at(i);
+			if (c == '\\' && i + 1 < str.size()) {
+				switch (str.at(++i).unicode())
+				{
+				case 't':
+					c = '\t';
+					break;
+				case 'n':
+					c = '\n';
+					break;
+				case 'r':
+					c = '\r';
+					break;
+				default:
+					c = str.at(i);
+					break;
+				}
+			}
+			result += c;
+		}
+		return result;
+	}
+
+	QByteArray Store::encode(const QVector<Change>& changes)
+	{
+		QString text;
+		for (const auto& x : changes) {
+			switch (x.type)
+			{
+			case Change::Type::Set:
+				text += "S\t" + escapeRecord(x.group) + "\t" + escapeRecord(x.key) + "\t" + escapeRecord(x.value) + "\n";
+				break;
+			case Change::Type::Remove:
+				text += "R\t" + escapeRecord(x.group) + "\t" + escapeRecord(x.key) + "\n";
+				break;
+			case Change::Type::RemoveSection:
+				text += "D\t" + escapeRecord(x.group) + "\n";
+				break;
+			case Change::Type::RemovePath:
+				text += "P\t" + escapeRecord(x.group) + "\t" + escapeRecord(x.key) + "\n";
+				break;
+			case Change::Type::AddSection:
+				text += "A\t" + escapeRecord(x.group) + "\n";
+				break;
+			case Change::Type::Move:
+				text += "M\t" + escapeRecord(x.group) + "\t" + escapeRecord(x.key) + "\t" + escapeRecord(x.target_group) + "\t" +
+					escapeRecord(x.target_key) + "\t" + QString::number(static_cast<int>(x.conflict)) + "\n";
+				break;
+			default:
+				break;
+			}
+		}
+		return text.toUtf8();
+	}
+
+	void Store::read(File& f, Document& doc)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		QFile file(f.path);
+		QByteArray data;
+		if (file.open(QFile::ReadOnly)) {
+			data = file.readAll();
+			file.close();
+			++stats.file_reads;
+			stats.bytes_read += data.size();
+			doc.parse(data, lazy);
+			++stats.parses;
+		}
+		else {
+			doc.clear();
+		}
+
+		QFileInfo fi(f.path);
+		f.exists = fi.exists();
+		f.size = f.exists ? fi.size() : -1;
+		f.modified = f.exists ? fi.lastModified() : QDateTime();
+		replay(f, doc, data);
+	}
+
+	void Store::replay(File& f, Document& doc, const QByteArray& content)
+	{
+		INI_TRACE_SCOPE(__FUNCTION__);
+		QFile file(f.journal);
+		if (!file.open(QFile::ReadOnly)) {
+			f.journal_size = -1;
+			f.journal_modified = QDateTime();
+			return;
+		}
+
+		auto data = file.readAll();
+		file.close();
+		++stats.file_reads;
+		stats.bytes_read += data.size();
+		QFileInfo fi(f.journal);
+		f.journal_size = fi.size();
+		f.journal_modified = fi.lastModified();
+
+		// ĩβδдļ¼(дʱ)
+		auto text = QString::fromUtf8(data.constData(), data.lastIndexOf('\n') + 1);
+		auto lines = text.splitRef('\n', QString::SkipEmptyParts);
+
+		// ϲ滻INIļ֮, ɾ־֮ǰж: ժҪINIļͬC¼֮ǰļ¼ѰINIļ
+		int first = 0;
+		QString hash;
+		for (int i = lines.size() - 1; i >= 0; --i) {
+			if (lines[i].startsWith("C\t")) {
+				if (hash.isEmpty()) {
+					hash = QString::fromLatin1(digest(content));
+				}
+
+				if (lines[i].mid(2) == hash) {
+					first = i + 1;
+					break;
+				}
+			}
+		}
+
+		for (int i = first; i < lines.size(); ++i) {
+			auto fields = lines[i].split('\t');
+			if (fields[0] == "S" && fields.size() == 4) {
+				apply(doc, { Change::Type::Set, unescapeRecord(fields[1]), unescapeRecord(fields[2]), unescapeRecord(fields[3]) });
+			}
+			else if (fields[0] == "R" && fields.size() == 3) {
+				apply(doc, { Change::Type::Remove, unescapeRecord(fields[1]), unescapeRecord(fields[2]), QString() });
+			}
+			else if (fields[0] == "D" && fields.size() == 2) {
+				apply(doc, { Change::Type::RemoveSection, unescapeRecord(fields[1]), QString(), QString() });
+			}
+			else if (fields[0] == "A" && fields.size() == 2) {
+				apply(doc, { Change::Type::AddSection, unescapeRecord(fields[1]), QString(), QString() });
+			}
+			else if (fields[0] == "P" && fields.size() == 3) {
+				apply(doc, { Change::Type::RemovePath, unescapeRecord(fields[1]), unescapeRecord(fields[2]), QString() });
+			}
+			else if (fields[0] == "M" && fields.size() == 6) {
+				apply(doc, { Change::Type::Move, unescapeRecord(fields[1]), unescapeRecord(fields[2]), QString(),
+					unescapeRecord(fields[3]), unescapeRecord(fields[4]), static_cast<Ini::Conflict>(fields[5].toInt()) });
+			}
+		}
+	}
+
+	bool Store::changed(const File& f) const
+	{
+		QFileInfo fi(f.path);
+		auto exists = fi.exists();
+		if (exists != f.exists || (exists && (fi.size() != f.size || fi.lastModified() != f.modified))) {
+			return true;
+		}
+
+		QFileInfo ji(f.journal);
+		auto size = ji.exists() ? ji.size() : -1;
+		return size != f.journal_size || (size != -1 && ji.lastModified() != f.journal_modified);
+	}
+
+	void Store::merge(File& f)
+	{
+		// ļϴμغ޸, ԴΪطű̵޸, ⸲ǶԷд
+		if (!changed(f) || (!QFileInfo::exists(f.path) && !QFileInfo::exists(f.journal))) {
+			return;
+		}
+
+		Document doc;
+		read(f, doc);
+		for (const auto& x : f.pending) {
+			apply(doc, x);
+		}
+		if (subscribed_ && &f == &ini) {
+			record(f.doc, doc);
+			publish();
+		}
+		f.doc = std::move(doc);
+	}
+
+	bool Store::flush(bool compact)
+	{
+		std::lock_guard<std::mutex> io(io_mutex);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto clean = ini.flushed >= ini.generation && comment.flushed >= comment.generation;
+			if (clean && !(compact && (ini.journal_size != -1 || comment.journal_size != -1))) {
+				return true;
+			}
+		}
+
+		auto locked = false;
+		if (locking) {
+			locked = file_lock.lock(FileLock::Mode::Exclusive, lock_timeout);
+			if (!locked) {
+				// ޸ıڴ, ´дʱһд
+				return false;
+			}
+		}
+
+		auto success = true;
+		for (auto f : { &ini, &comment }) {
+			QByteArray data;
+			quint64 generation = 0;
+			int count = 0;
+			auto full = true;
+			auto journaled = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto dirty = f->flushed < f->generation;
+				if (!dirty && !(compact && f->journal_size != -1)) {
+					continue;
+				}
+
+				merge(*f);
+				generation = f->generation;
+				count = f->pending.size();
+				journaled = f->journal_size != -1;
+				if (journaling && dirty && !compact) {
+					// ֻ׷ӱε޸, ־ʱϲINIļ
+					data = encode(f->pending);
+					auto size = std::max<qint64>(0, f->journal_size) + data.size();
+					full = size > compact_size || (f->size > 0 && size > f->size * compact_ratio);
+				}
+
+				if (full) {
+					data = f->doc.serialize();
+				}
+			}
+
+			// дʱĵ, ߳̿ɼдڴ
+			auto written = true;
+			if (full && journaled) {
+				// 滻INIļǰ־мݵժҪ, 滻ɾ־ǰжʱ,
+				// ʱݴѺϲľɼ¼, 滻ǰжʱժҪ, طȫ¼
+				written = appendFile(f->journal, "C\t" + digest(data) + "\n", durability);
+			}
+
+			if (written) {
+				written = full ? writeFile(f->path, data, durability) : appendFile(f->journal, data, durability);
+				if (written) {
+					++stats.file_writes;
+					stats.bytes_written += data.size();
+				}
+			}
+
+			if (written && full && journaled) {
+				// INIļѰȫ, ɾѺϲ־
+				QFile journal(f->journal);
+				written = journal.remove() || journal.open(QFile::WriteOnly | QFile::Truncate);
+				if (written && durability == Ini::Durability::FsyncDir) {
+					syncDir(f->journal);
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (written) {
+				f->flushed = generation;
+				f->pending.remove(0, count);
+				if (full) {
+					QFileInfo fi(f->path);
+					f->exists = true;
+					f->size = fi.size();
+					f->modified = fi.lastModified();
+				}
+
+				QFileInfo ji(f->journal);
+				f->journal_size = ji.exists() ? ji.size() : -1;
+				f->journal_modified = ji.exists() ? ji.lastModified() : QDateTime();
+			}
+			else {
+				success = false;
+			}
+		}
+
+		if (locked) {
+			file_lock.unlock();
+		}
+		return success;
+	}
+
+	void Store::schedule(QFutureInterface<bool>* waiter)
+	{
+		{
+			std::lock_guard<std::mutex> lock(flusher_mutex_);
+			if (!flusher_.joinable()) {
+				flusher_ = std::thread(&Store::run, this);
+			}
+
+			requested_ = true;
+			if (waiter) {
+				waiters_.append(*waiter);
+				urgent_ = true;
+			}
+		}
+		flusher_cv_.notify_all();
+	}
+
+	bool Store::waitForFlush(int timeout)
+	{
+		if (isClean()) {
+			return true;
 		}
 
-		inline Context(const Context& ctx)
-			: mutex(nullptr)
 		{
-			counter = ctx.counter;
-			if (!mutex) {
-				mutex = std::make_unique<std::mutex>();
+			std::lock_guard<std::mutex> lock(flusher_mutex_);
+			if (!flusher_.joinable()) {
+				// δų́д, ֱд
+				return flush();
 			}
+			requested_ = true;
+			urgent_ = true;
+		}
+		flusher_cv_.notify_all();
+
+		std::unique_lock<std::mutex> lock(flusher_mutex_);
+		auto pred = [this] { return stop_ || isClean(); };
+		if (timeout < 0) {
+			flushed_cv_.wait(lock, pred);
+			return isClean();
 		}
+		return flushed_cv_.wait_for(lock, std::chrono::milliseconds(timeout), pred) && isClean();
+	}
+
+	bool Store::isClean()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return ini.flushed >= ini.generation && comment.flushed >= comment.generation;
+	}
+
+	void Store::run()
+	{
+		std::unique_lock<std::mutex> lock(flusher_mutex_);
+		for (;;) {
+			flusher_cv_.wait(lock, [this] { return stop_ || requested_; });
+			if (!stop_ && !urgent_) {
+				// ȴһСʱ, ڼ޸ĺϲΪһд
+				flusher_cv_.wait_for(lock, std::chrono::milliseconds(write_delay.load()), [this] { return stop_ || urgent_; });
+			}
 
-		inline Context& operator=(const Context& ctx) {
-			if (this == &ctx) {
-				return *this;
+			if (stop_ && waiters_.isEmpty()) {
+				break;
+			}
+
+			requested_ = false;
+			urgent_ = false;
+			auto waiters = std::move(waiters_);
+			waiters_.clear();
+			lock.unlock();
+
+			auto result = flush();
+			for (auto& x : waiters) {
+				x.reportResult(result);
+				x.reportFinished();
 			}
-			counter = ctx.counter;
-			if (!mutex) {
-				mutex = std::make_unique<std::mutex>();
+
+			lock.lock();
+			flushed_cv_.notify_all();
+			if (!result && !stop_) {
+				// дʧ(ȡļʱ), Ժ
+				flusher_cv_.wait_for(lock, std::chrono::milliseconds(kRetryInterval), [this] { return stop_ || urgent_; });
+				requested_ = true;
 			}
-			return *this;
 		}
+		flushed_cv_.notify_all();
+	}
+}
+
+double IniHistogram::mean() const
+{
+	return count ? total / 1000.0 / count : 0.0;
+}
 
-		inline void lock() { mutex->lock(); }
-		inline void unlock() { mutex->unlock(); }
+double IniHistogram::percentile(double percent) const
+{
+	if (!count) {
+		return 0.0;
+	}
 
-		int counter;
-		std::unique_ptr<std::mutex> mutex;
-	};
-	static std::map<QString, Context> file_lock;
+	auto rank = std::max<quint64>(1, static_cast<quint64>(std::ceil(count * percent / 100.0)));
+	quint64 accumulated = 0;
+	for (int i = 0; i < kBuckets; ++i) {
+		accumulated += buckets[i];
+		if (accumulated >= rank) {
+			return std::min<double>(1ull << i, max / 1000.0);
+		}
+	}
+	return max / 1000.0;
 }
 
 Ini::Ini(const QString& filePath, bool encryptData)
-	:encrypt_data_(encryptData), recursive_mutex_(new QRecursiveMutex), key_sort_(false)
+	:encrypt_data_(encryptData), recursive_mutex_(new QRecursiveMutex), key_sort_(false), stats_(new ini::Stats)
 {
 	//DBG_PRINT << __FUNCTION__;
 	// 캯ҪΪδ
@@ -80,30 +3394,25 @@ Ini::Ini(const QString& filePath, bool encryptData)
 		dir.mkpath(dirPath);
 	}
 	createCrypt();
-
-	std::lock_guard<std::mutex> lock(ini::mutex);
-	++ini::file_lock[ini_file_].counter;
-	//DBG_PRINT << "add" << ini_file_ << "counter" << ini::file_lock[ini_file_].counter;
+	attachStore();
 }
 
 Ini::~Ini()
 {
+	// ȡĲ뿪ĵ, ȴִеĻصͷŻܾ,
+	// صԿɰȫطʱʵ
+	//DBG_PRINT << __FUNCTION__;
+	detachStore();
+
 	destroyCrypt();
 	if (recursive_mutex_) {
 		delete recursive_mutex_;
 		recursive_mutex_ = nullptr;
 	}
-
-	//DBG_PRINT << __FUNCTION__;
-	std::lock_guard<std::mutex> lock(ini::mutex);
-	if (--ini::file_lock[ini_file_].counter == 0) {
-		ini::file_lock.erase(ini_file_);
-		//DBG_PRINT << "remove" << ini_file_;
-	}
 }
 
 Ini::Ini(const Ini& other)
-	: recursive_mutex_(nullptr)
+	: recursive_mutex_(nullptr), stats_(new ini::Stats)
 {
 	if (!recursive_mutex_) {
 		recursive_mutex_ = new QRecursiveMutex;
@@ -113,13 +3422,9 @@ Ini::Ini(const Ini& other)
 	comment_file_ = other.comment_file_;
 	encrypt_data_ = other.encrypt_data_;
 	key_sort_ = other.key_sort_;
+	async_write_ = other.async_write_;
 	createCrypt();
-
-	{
-		std::lock_guard<std::mutex> lock(ini::mutex);
-		++ini::file_lock[ini_file_].counter;
-		//DBG_PRINT << "add" << ini_file_ << "counter" << ini::file_lock[ini_file_].counter;
-	}
+	attachStore();
 }
 
 Ini& Ini::operator=(const Ini& other)
@@ -132,31 +3437,21 @@ Ini& Ini::operator=(const Ini& other)
 		recursive_mutex_ = new QRecursiveMutex;
 	}
 
-	{
-		std::lock_guard<std::mutex> lock(ini::mutex);
-		if (--ini::file_lock[ini_file_].counter == 0) {
-			ini::file_lock.erase(ini_file_);
-			//DBG_PRINT << "remove" << ini_file_;
-		}
-	}
+	detachStore();
 
 	ini_file_ = other.ini_file_;
 	comment_file_ = other.comment_file_;
 	encrypt_data_ = other.encrypt_data_;
 	key_sort_ = other.key_sort_;
+	async_write_ = other.async_write_;
 	createCrypt();
-
-	{
-		std::lock_guard<std::mutex> lock(ini::mutex);
-		++ini::file_lock[ini_file_].counter;
-		//DBG_PRINT << "add" << ini_file_ << "counter" << ini::file_lock[ini_file_].counter;
-	}
+	attachStore();
 	return *this;
 }
 
 QString Ini::filePath() const
 {
-	QMutexLocker lock(recursive_mutex_);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 	return ini_file_;
 }
 
@@ -274,6 +3569,7 @@ void Ini::traverseArray(const QString& prefix, IniTraverseArrayCb&& func)
 // ޸ĸͼ
 void Ini::buildGroupAndKeyName(const QString& key, QString& groupName, QString& keyName) const
 {
+	INI_TRACE_SCOPE(__FUNCTION__);
 	if (ctx()->inArray && !ctx()->arrayPrefix.isEmpty()) {
 		// Ĵ߼䣩
 		if (key == "size") {
@@ -403,9 +3699,31 @@ void Ini::buildGroupAndKeyName(const QString& key, QString& groupName, QString&
 	//keyName.replace('/', '\\');
 }
 
+bool Ini::splitGroupAndKeyName(QStringView key, QStringView& groupName, QStringView& keyName) const
+{
+	auto c = ctx();
+	if (c->inArray || !c->group.isEmpty()) {
+		return false;
+	}
+
+	// buildGroupAndKeyNameķ, ķ֧һ
+	auto firstSlash = key.indexOf('/');
+	if (firstSlash != -1 && firstSlash + 1 < key.size()) {
+		groupName = key.left(firstSlash);
+		keyName = key.mid(firstSlash + 1);
+	}
+	else {
+		groupName = QStringView();
+		keyName = key;
+	}
+	return true;
+}
+
 void Ini::setValue(const QString& key, const Variant& value)
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::SetValue]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QString groupName;
 	QString keyName;
@@ -416,56 +3734,60 @@ void Ini::setValue(const QString& key, const Variant& value)
 		keyName = key;
 	}
 
-	QString str;
-	if (value.type() == QVariant::Type::StringList) {
-		auto strs = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toStringList();
-		if (!strs.isEmpty()) {
-			auto joined = "\"" + strs.join("\", \"") + "\"";
-			str = "{" + joined + "}";
-		}
-		else {
-			str = "{}";
-		}
-	}
-	else if (value.type() == QMetaType::QJsonObject) {
-		auto jsonobj = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toJsonObject();
-		QJsonDocument doc(jsonobj);
-		str = doc.toJson(QJsonDocument::Compact);
-	}
-	else if (value.type() == QMetaType::QJsonArray) {
-		auto jsonarr = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toJsonArray();
-		QJsonDocument doc(jsonarr);
-		str = doc.toJson(QJsonDocument::Compact);
+	auto str = IniWriter::encode(value);
+	writeFileData(groupName, keyName, str, ini_file_);
+}
+
+void Ini::setValue(QStringView key, const Variant& value)
+{
+	QStringView groupView, keyView;
+	if (!splitGroupAndKeyName(key, groupView, keyView)) {
+		setValue(key.toString(), value);
+		return;
 	}
-	else if (value.type() == QVariant::ByteArray) {
-		auto bytes = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toByteArray();
-		QStringList strs;
-		if (!bytes.isEmpty()) {
-			for (int i = 0; i < bytes.size(); ++i) {
-				auto uc = static_cast<uchar>(bytes[i]);
-				strs.append(QString::asprintf("0x%02x", uc));
+
+	ini::OperationTimer timer(stats_->operations[IniStats::SetValue]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+
+	if (groupView.isEmpty()) {
+		groupView = u"General";
+	}
+
+	// Ѵڵĵе, ֻ½ʱŸͼ
+	QString groupName, keyName;
+	if (keyView.indexOf('/') == -1) {
+		auto& f = store_->ini;
+		fileLock(__FUNCTION__);
+		store_->refresh(f);
+		auto s = f.doc.section(groupView);
+		if (s) {
+			groupName = s->name;
+			auto e = f.doc.entry(groupView, keyView);
+			if (e) {
+				keyName = e->key;
 			}
-			str = "{" + strs.join(",") + "}";
-		}
-		else {
-			str = "{}";
 		}
+		fileUnlock();
 	}
-	else if (value.userType() == static_cast<int>(Variant::UserType::Range)) {
-		// QPair->range
-		auto pair = value.toRange<QString>();
-		str = QString("%1~%2").arg(pair.first, pair.second);
+
+	if (groupName.isEmpty()) {
+		groupName = groupView.toString();
 	}
-	else {
-		str = value.toString();
+
+	if (keyName.isEmpty()) {
+		keyName = keyView.toString();
 	}
 
+	auto str = IniWriter::encode(value);
 	writeFileData(groupName, keyName, str, ini_file_);
 }
 
 void Ini::setComment(const QString& key, const QString& comment)
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::SetComment]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QString groupName;
 	QString keyName;
@@ -495,7 +3817,9 @@ void Ini::newValue(const QString& key, const Variant& value, const QString& comm
 
 Variant Ini::value(const QString& key, const Variant& defaultValue) const
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::Value]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QString groupName;
 	QString keyName;
@@ -509,9 +3833,29 @@ Variant Ini::value(const QString& key, const Variant& defaultValue) const
 	return readFileData(groupName, keyName, defaultValue.toString(), ini_file_);
 }
 
+Variant Ini::value(QStringView key, const Variant& defaultValue) const
+{
+	QStringView groupView, keyView;
+	if (!splitGroupAndKeyName(key, groupView, keyView)) {
+		return value(key.toString(), defaultValue);
+	}
+
+	ini::OperationTimer timer(stats_->operations[IniStats::Value]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+
+	if (groupView.isEmpty()) {
+		groupView = u"General";
+	}
+
+	return readFileData(groupView, keyView, defaultValue.toString(), ini_file_);
+}
+
 QString Ini::comment(const QString& key, const QString& defaultComment) const
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::Comment]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QString groupName;
 	QString keyName;
@@ -527,7 +3871,10 @@ QString Ini::comment(const QString& key, const QString& defaultComment) const
 
 void Ini::remove(const QString& key)
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::Remove]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	UpdateLocker updater(this);
 
 	QString groupName;
 	QString keyName;
@@ -536,50 +3883,14 @@ void Ini::remove(const QString& key)
 	if (groupName.isEmpty()) {
 		// ɾgroup
 		removeFileData(key, QString(), ini_file_);
+		removeFileData(key, QString(), comment_file_);
 		return;
 	}
 
-	if (isGroup(groupName + "/" + keyName)) {
-		auto properties = childProperties(groupName);
-		for (const auto& x : properties) {
-			if (x.first.indexOf(keyName + "/") != -1) {
-				removeFileData(groupName, x.first, ini_file_);
-				removeFileData(groupName, x.first, comment_file_);
-			}
-		}
-	}
-	else if (isArray(groupName + "/" + keyName)) {
-		auto properties = childProperties(groupName);
-		auto size = 0;
-		for (const auto& x : properties) {
-			if (x.first == keyName + "/size") {
-				size = x.second.toInt();
-				break;
-			}
-		}
-
-		QSet<QString> elements;
-		auto index = 0;
-		for (const auto& x : properties) {
-			index = x.first.indexOf(keyName + "/1");
-			if (index != -1) {
-				index = x.first.lastIndexOf("/");
-				if (index != -1) {
-					elements.insert(x.first.mid(index + 1));
-				}
-			}
-		}
-
-		for (const auto& x : elements) {
-			for (int i = 0; i < size; ++i) {
-				auto tempKeyName = keyName + "/" + QString::number(i + 1) + "/" + x;
-				removeFileData(groupName, tempKeyName, ini_file_);
-				removeFileData(groupName, tempKeyName, comment_file_);
-			}
-		}
-
-		removeFileData(groupName, keyName + "/size", ini_file_);
-		removeFileData(groupName, keyName + "/size", comment_file_);
+	if (pathIsGroup(groupName, keyName) || pathArraySize(groupName, keyName) != -1) {
+		// ɾ, ڴһɾ, ʱÿļֻдһ
+		removePathData(groupName, keyName, ini_file_);
+		removePathData(groupName, keyName, comment_file_);
 	}
 	else {
 		removeFileData(groupName, keyName, ini_file_);
@@ -587,125 +3898,76 @@ void Ini::remove(const QString& key)
 	}
 }
 
-void Ini::rename(const QString& oldKeyPath, const QString& newKeyName)
+bool Ini::rename(const QString& oldKeyPath, const QString& newKeyName, Conflict conflict)
 {
-	QMutexLocker locker(recursive_mutex_);
-
-	QString groupName;
-	QString keyName;
-	buildGroupAndKeyName(oldKeyPath, groupName, keyName);
+	// ֻ滻һ
+	auto lastSlash = oldKeyPath.lastIndexOf('/');
+	auto newKeyPath = lastSlash != -1 ? oldKeyPath.left(lastSlash + 1) + newKeyName : newKeyName;
+	return move(oldKeyPath, newKeyPath, conflict);
+}
 
-	if (groupName.isEmpty()) {
-		// ֱӽ޸
-		auto properties = childProperties(oldKeyPath);
-		for (int i = 0; i < properties.size(); ++i) {
-			const auto& pair = properties[i];
-			const auto& key = pair.first;
-			const auto& value = pair.second;
-			setValue(QString("%1/%2").arg(newKeyName, key), value);
-		}
-		remove(oldKeyPath);
+bool Ini::move(const QString& fromKeyPath, const QString& toKeyPath, Conflict conflict)
+{
+	ini::OperationTimer timer(stats_->operations[IniStats::Rename]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	UpdateLocker updater(this);
+
+	QString fromGroup, fromKey, toGroup, toKey;
+	buildGroupAndKeyName(fromKeyPath, fromGroup, fromKey);
+	buildGroupAndKeyName(toKeyPath, toGroup, toKey);
+
+	// /ҲڷʱΪ
+	if (fromGroup.isEmpty()) {
+		fromGroup = fromKeyPath;
+		fromKey.clear();
 	}
-	else {
-		auto properties = childProperties(groupName);
-		for (int i = 0; i < properties.size(); ++i) {
-			auto pair = properties[i];
-			if (pair.first.indexOf(keyName) != -1 &&
-				pair.first.indexOf(keyName + "/") != -1) {
-				auto result = false;
-				auto value = readFileData(groupName, pair.first, QString(), ini_file_, &result);
-				if (!result) {
-					return;
-				}
-
-				auto lastSlash0 = keyName.lastIndexOf("/");
-				auto lastSlash1 = pair.first.lastIndexOf("/") + 1;
-				auto lastSlash2 = oldKeyPath.lastIndexOf("/");
-				QString realOldKey;
-				if (lastSlash2 != -1) {
-					realOldKey = oldKeyPath.mid(lastSlash2 + 1);
-				}
-				else {
-					realOldKey = oldKeyPath;
-				}
-				auto keyOld = keyName.mid(0, lastSlash0) + "/" + realOldKey + "/" + pair.first.mid(lastSlash1);
-				auto keyNew = keyName.mid(0, lastSlash0) + "/" + newKeyName + "/" + pair.first.mid(lastSlash1);
-				auto contains = false;
-				for (int j = 0; j < properties.size(); ++j) {
-					if (properties[j].first == keyNew) {
-						contains = true;
-						break;
-					}
-				}
-
-				if (contains) {
-					continue;
-				}
-
-				writeFileData(groupName, keyNew, value, ini_file_);
-				auto description = readFileData(groupName, pair.first, QString(), comment_file_, &result);
-				if (result) {
-					writeFileData(groupName, keyNew, description, comment_file_);
-				}
-				fastRemove(groupName, keyOld);
-			}
-			else if (pair.first == keyName) {
-				auto i0 = pair.first.lastIndexOf("/");
-				if (i0 != -1) {
-					auto keyNew = pair.first.mid(0, i0) + "/" + newKeyName;
-					auto keyOld = pair.first;
-					auto result = false;
-					auto description = readFileData(groupName, keyOld, QString(), comment_file_, &result);
-					auto value = pair.second;
-					auto contains = false;
-					for (int j = 0; j < properties.size(); ++j) {
-						if (properties[j].first == keyNew) {
-							contains = true;
-							break;
-						}
-					}
-
-					if (contains) {
-						continue;
-					}
 
-					writeFileData(groupName, keyNew, value, ini_file_);
-					if (result) {
-						writeFileData(groupName, keyNew, description, comment_file_);
-					}
-					fastRemove(groupName, keyOld);
-				}
-				else {
-					auto contains = false;
-					for (int j = 0; j < properties.size(); ++j) {
-						if (properties[j].first == newKeyName) {
-							contains = true;
-							break;
-						}
-					}
+	if (toGroup.isEmpty()) {
+		toGroup = toKeyPath;
+		toKey.clear();
+	}
 
-					if (contains) {
-						continue;
-					}
+	if (fromGroup.isEmpty() || toGroup.isEmpty()) {
+		return false;
+	}
 
-					writeFileData(groupName, newKeyName, pair.second, ini_file_);
-					auto result = false;
-					auto description = readFileData(groupName, pair.first, QString(), comment_file_, &result);
-					if (result) {
-						writeFileData(groupName, newKeyName, pair.second, comment_file_);
-					}
-					fastRemove(groupName, pair.first);
-				}
-			}
-		}
+	QVector<QPair<QString, QString>> moved;
+	auto result = movePathData(fromGroup, fromKey, toGroup, toKey, conflict, ini_file_, &moved);
+	if (result <= 0) {
+		return false;
 	}
+
+	// עֻʵƶֵ, ٶעļжϳͻ
+	moveComments(fromGroup, toGroup, toKey, moved, conflict == Conflict::Overwrite);
+	return true;
 }
 
 bool Ini::contains(const QString& key) const
 {
+	ini::OperationTimer timer(stats_->operations[IniStats::Contains]);
+	INI_TRACE_SCOPE(__FUNCTION__);
 	return contains(key, 0);
 }
 
+bool Ini::contains(QStringView key) const
+{
+	QStringView groupView, keyView;
+	if (!splitGroupAndKeyName(key, groupView, keyView)) {
+		return contains(key.toString());
+	}
+
+	ini::OperationTimer timer(stats_->operations[IniStats::Contains]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+
+	if (groupView.isEmpty()) {
+		// contains(key, 0)һ, /ʱ
+		return containsFileData(key, QStringView(), ini_file_);
+	}
+	return containsFileData(groupView, keyView, ini_file_);
+}
+
 bool Ini::isGroup(const QString& key) const
 {
 	QString groupName, keyName;
@@ -715,31 +3977,7 @@ bool Ini::isGroup(const QString& key) const
 		return childGroups().contains(key);
 	}
 
-	auto properties = childProperties(groupName);
-	for (const auto& x : properties) {
-		auto index = x.first.indexOf(keyName);
-		if (index != -1 && x.first.indexOf(keyName + "/") != -1) {
-			// ٴȷǷΪ
-			auto findIndex = false, findSize = false;
-			for (const auto& y : properties) {
-				if (y.first.indexOf(keyName + "/1/") != -1) {
-					findIndex = true;
-				}
-
-				if (y.first.indexOf(keyName + "/size") != -1) {
-					findSize = true;
-				}
-			}
-
-			return !(findIndex && findSize);
-		}
-		//else if (index != -1) {
-		//	// жsize
-		//	return false;
-		//}
-	}
-
-	return false;
+	return pathIsGroup(groupName, keyName);
 }
 
 bool Ini::isArray(const QString& key) const
@@ -751,145 +3989,37 @@ bool Ini::isArray(const QString& key) const
 		return false;
 	}
 
-	auto properties = childProperties(groupName);
-	for (const auto& x : properties) {
-		auto index = x.first.indexOf(keyName + "/");
-		if (index != -1) {
-			auto count = 1;
-			auto size = 0;
-			QList<int> nums;
-			for (const auto& y : properties) {
-				if (y.first.indexOf(keyName + QString("/%1/").arg(count)) != -1) {
-					if (!nums.contains(count)) {
-						nums.append(count++);
-					}
-				}
-
-				if (y.first.indexOf(keyName + "/size") != -1) {
-					size = y.second.toInt();
-				}
-			}
-
-			if (nums.isEmpty() || size == 0) {
-				return false;
-			}
-
-			// nums<size,ᵼԽ.
-			if (nums.size() < size) {
-				return false;
-			}
-
-			count = 1;
-			for (const auto& y : nums) {
-				// Ϊ
-				if (count++ != y) {
-					return false;
-				}
-			}
-			return true;
-		}
-	}
-
-	return false;
+	// Ԫر1ʼҲsize, sizeԽ
+	return pathArraySize(groupName, keyName) != -1;
 }
 
 QStringList Ini::allKeys() const
 {
-	QMutexLocker locker(recursive_mutex_);
-
-	QStringList result, keys;
-	QString group, key;
-	if (!ctx()->group.isEmpty() && ctx()->arrayPrefix.isEmpty()) {
-		auto hindex = ctx()->group.indexOf("/");
-		if (hindex != -1) {
-			group = ctx()->group.mid(0, hindex);
-			//auto tindex = ctx()->group.lastIndexOf("/");
-			//if (tindex != -1 && tindex != hindex) {
-			//	tail = ctx()->group.mid(tindex);
-			//}
-			//else {
-			//	tail = ctx()->group.mid(hindex + 1);
-			//}
-			key = ctx()->group.mid(hindex + 1);
-		}
-		else {
-			group = ctx()->group;
-		}
-		keys.append(group);
-	}
-	else if (ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		auto index = ctx()->arrayPrefix.indexOf("/");
-		if (index != -1) {
-			group = ctx()->arrayPrefix.mid(0, index);
-			key = ctx()->arrayPrefix.mid(index + 1);
-			keys.append(group);
-		}
-		else {
-			keys.append(ctx()->arrayPrefix);
-		}
-	}
-	else if (!ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		auto hindex = ctx()->group.indexOf("/");
-		if (hindex != -1) {
-			group = ctx()->group.mid(0, hindex);
-			auto tindex = ctx()->group.lastIndexOf("/");
-			//if (tindex != -1 && tindex != hindex) {
-			//	key = ctx()->group.mid(tindex);
-			//}
-			//else {
-			//	key = ctx()->group.mid(hindex + 1);
-			//}
-			key = ctx()->group.mid(hindex + 1);
-			key += "/" + ctx()->arrayPrefix;
-		}
-		else {
-			group = ctx()->group;
-			key = ctx()->arrayPrefix;
-		}
-		keys.append(group);
-	}
-	else {
-		keys = childGroups();
-	}
-	size_t size = 4096;
-	std::unique_ptr<wchar_t[]> buffer = nullptr;
-
-REALLOCATE_MEMORY:
-	buffer.reset(new wchar_t[size]);
-	memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-
-	for (const auto& x : keys) {
-		auto app = x.toStdWString();
-		fileLock();
-		auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY;
-		}
+	ini::OperationTimer timer(stats_->operations[IniStats::AllKeys]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& y : split0) {
-			auto split1 = y.split("=", QString::SkipEmptyParts);
-			if (ctx()->group.isEmpty()) {
-				result.append(QString("%1/%2").arg(x, split1[0]).replace("\\", "/"));
-			}
-			else {
-				result.append(split1[0].replace("\\", "/"));
+	QStringList result;
+	QString path;
+	auto group = ctxPath(false, &path);
+	if (group.isEmpty()) {
+		for (const auto& x : childGroups()) {
+			for (const auto& y : sectionKeys(x)) {
+				result.append(QString("%1/%2").arg(x, y));
 			}
 		}
 	}
-
-	if (!key.isEmpty()) {
-		QStringList temp;
-		for (int i = 0; i < result.size(); ++i) {
-			auto index = result[i].indexOf(key + "/");
-			if (index != -1) {
-				temp.append(result[i].mid(index + key.length() + 1));
+	else if (path.isEmpty()) {
+		result = sectionKeys(group);
+		if (ctx()->group.isEmpty()) {
+			// ڷеĶ, 벻ڷʱһн
+			for (auto& x : result) {
+				x = QString("%1/%2").arg(group, x);
 			}
 		}
-		result = temp;
+	}
+	else {
+		result = pathKeys(group, path, ini_file_);
 	}
 
 	if (key_sort_) {
@@ -900,173 +4030,15 @@ REALLOCATE_MEMORY:
 
 QStringList Ini::childKeys() const
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::ChildKeys]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QStringList result;
-	if (!ctx()->group.isEmpty() && ctx()->arrayPrefix.isEmpty()) {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer = nullptr;
-
-	REALLOCATE_MEMORY0:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-		std::wstring app;
-		auto firstSlash = ctx()->group.indexOf("/");
-		QString childKey;
-		if (firstSlash != -1) {
-			app = ctx()->group.left(firstSlash).toStdWString();
-			childKey = ctx()->group.mid(firstSlash + 1);
-		}
-		else {
-			app = ctx()->group.toStdWString();
-		}
-		fileLock();
-		auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY0;
-		}
-
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& x : split0) {
-			auto split1 = x.split("=", QString::SkipEmptyParts);
-			result.append(split1[0].replace("\\", "/"));
-		}
-
-		QStringList temp;
-		if (firstSlash != -1) {
-			for (int i = 0; i < result.size(); ++i) {
-				auto index = result[i].indexOf(childKey + "/");
-				if (index != -1) {
-					auto mid = result[i].mid(index + childKey.length() + 1);
-					if (mid.indexOf("/") == -1) {
-						temp.append(mid);
-					}
-				}
-			}
-		}
-		else {
-			for (int i = 0; i < result.size(); ++i) {
-				auto index = result[i].indexOf("/");
-				if (index == -1) {
-					temp.append(result[i]);
-				}
-			}
-		}
-		result = temp;
-	}
-	else if (!ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer = nullptr;
-
-	REALLOCATE_MEMORY1:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-		std::wstring app;
-		auto firstSlash = ctx()->group.indexOf("/");
-		QString childKey;
-		if (firstSlash != -1) {
-			app = ctx()->group.left(firstSlash).toStdWString();
-			childKey = ctx()->group.mid(firstSlash + 1) + "/" + ctx()->arrayPrefix;
-		}
-		else {
-			app = ctx()->group.toStdWString();
-			childKey = ctx()->arrayPrefix;
-		}
-
-		if (ctx()->arrayIndex != -1) {
-			childKey += "/" + QString::number(ctx()->arrayIndex + 1);
-		}
-
-		fileLock();
-		auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY1;
-		}
-
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& x : split0) {
-			auto split1 = x.split("=", QString::SkipEmptyParts);
-			result.append(split1[0].replace("\\", "/"));
-		}
-
-		QStringList temp;
-		for (int i = 0; i < result.size(); ++i) {
-			auto index = result[i].indexOf(childKey + "/");
-			if (index != -1) {
-				auto mid = result[i].mid(index + childKey.length() + 1);
-				if (mid.indexOf("/") == -1) {
-					temp.append(mid);
-				}
-			}
-		}
-
-		result = temp;
-	}
-	else if (ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer = nullptr;
-
-	REALLOCATE_MEMORY2:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-		std::wstring app;
-		QString childKey;
-		auto firstSlash = ctx()->arrayPrefix.indexOf("/");
-		if (firstSlash != -1) {
-			app = ctx()->arrayPrefix.mid(0, firstSlash).toStdWString();
-			childKey = ctx()->arrayPrefix.mid(firstSlash + 1);
-			if (ctx()->arrayIndex != -1) {
-				childKey += "/" + QString::number(ctx()->arrayIndex + 1);
-			}
-		}
-		else {
-			app = ctx()->arrayPrefix.toStdWString();
-			if (ctx()->arrayPrefix != -1) {
-				childKey = QString::number(ctx()->arrayIndex + 1);
-			}
-		}
-
-		fileLock();
-		auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY2;
-		}
-
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& x : split0) {
-			auto split1 = x.split("=", QString::SkipEmptyParts);
-			result.append(split1[0].replace("\\", "/"));
-		}
-
-		QStringList temp;
-		for (int i = 0; i < result.size(); ++i) {
-			if (!childKey.isEmpty()) {
-				auto str = childKey + "/";
-				auto index = result[i].indexOf(str);
-				if (index != -1 && result[i].left(str.length()) == str) {
-					auto mid = result[i].mid(index + childKey.length() + 1);
-					if (mid.indexOf("/") == -1) {
-						temp.append(mid);
-					}
-				}
-			}
-			else {
-				if (result[i].indexOf("/") == -1) {
-					temp.append(result[i]);
-				}
-			}
-		}
-
-		result = temp;
+	QString path;
+	auto group = ctxPath(true, &path);
+	if (!group.isEmpty()) {
+		result = pathChildren(group, path, false);
 	}
 
 	if (key_sort_) {
@@ -1077,152 +4049,18 @@ QStringList Ini::childKeys() const
 
 QStringList Ini::childGroups() const
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::OperationTimer timer(stats_->operations[IniStats::ChildGroups]);
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QStringList result;
-	if (ctx()->group.isEmpty() && ctx()->arrayPrefix.isEmpty()) {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer;
-
-	REALLOCATE_MEMORY0:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0, size * sizeof(wchar_t));
-		fileLock();
-		auto length = GetPrivateProfileSectionNames(buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY0;
-		}
-
-		result = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-	}
-	else if (ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		//error where
-		QString group, key;
-		auto firstSlash = ctx()->arrayPrefix.indexOf("/");
-		if (firstSlash != -1) {
-			group = ctx()->arrayPrefix.mid(0, firstSlash);
-			key = ctx()->arrayPrefix.mid(firstSlash + 1);
-		}
-		else {
-			group = ctx()->arrayPrefix;
-		}
-
-		auto properties = childProperties(group);
-		for (const auto& x : properties) {
-			// ҪԽctx()->arrayPrefix
-			if (key.isEmpty()) {
-				auto index = x.first.indexOf("/");
-				if (index != -1) {
-					auto arrayIndex = x.first.mid(0, index);
-					if (!result.contains(arrayIndex)) {
-						result.append(arrayIndex);
-					}
-				}
-			}
-			else {
-				auto index = x.first.indexOf(key + "/");
-				if (index != -1) {
-					auto arrayIndex = x.first.mid(key.length() + 1);
-					index = arrayIndex.indexOf("/");
-					if (index != -1) {
-						arrayIndex = arrayIndex.mid(0, index);
-						if (!result.contains(arrayIndex)) {
-							result.append(arrayIndex);
-						}
-					}
-				}
-			}
-		}
-	}
-	else if (!ctx()->group.isEmpty() && !ctx()->arrayPrefix.isEmpty()) {
-		QString group, key;
-		auto firstSlash = ctx()->group.indexOf("/");
-		if (firstSlash != -1) {
-			key = ctx()->group.mid(firstSlash + 1) + "/" + ctx()->arrayPrefix;
-			group = ctx()->group.mid(0, firstSlash);
-		}
-		else {
-			group = ctx()->group;
-			key = ctx()->arrayPrefix;
-		}
-
-		auto properties = childProperties(group);
-		for (const auto& x : properties) {
-			auto index = x.first.indexOf(key + "/");
-			if (index != -1) {
-				auto first = x.first.mid(key.length() + 1);
-				index = first.indexOf("/");
-				if (index != -1) {
-					auto group = first.mid(0, index);
-					if (!result.contains(group)) {
-						result.append(group);
-					}
-				}
-			}
-		}
-	}
-	else {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer = nullptr;
-
-	REALLOCATE_MEMORY1:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-		std::wstring app;
-		auto firstSlash = ctx()->group.indexOf("/");
-		QString childKey;
-		if (firstSlash != -1) {
-			app = ctx()->group.left(firstSlash).toStdWString();
-			childKey = ctx()->group.mid(firstSlash + 1);
-		}
-		else {
-			app = ctx()->group.toStdWString();
-		}
-		fileLock();
-		auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY1;
-		}
-
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& x : split0) {
-			auto split1 = x.split("=", QString::SkipEmptyParts);
-			result.append(split1[0].replace("\\", "/"));
-		}
-
-		QStringList temp;
-		if (firstSlash != -1) {
-			for (int i = 0; i < result.size(); ++i) {
-				auto index = result[i].indexOf(childKey + "/");
-				if (index != -1) {
-					auto mid = result[i].mid(index + childKey.length() + 1);
-					if ((index = mid.indexOf("/")) != -1) {
-						auto v = mid.mid(0, index);
-						if (!temp.contains(v)) {
-							temp.append(v);
-						}
-					}
-				}
-			}
-		}
-		else {
-			for (int i = 0; i < result.size(); ++i) {
-				auto index = result[i].indexOf("/");
-				if (index != -1) {
-					auto v = result[i].mid(0, index);
-					if (!temp.contains(v)) {
-						temp.append(v);
-					}
-				}
-			}
-		}
-		result = temp;
+	QString path;
+	auto group = ctxPath(false, &path);
+	if (group.isEmpty()) {
+		result = sectionNames(ini_file_);
+	}
+	else {
+		result = pathChildren(group, path, true);
 	}
 
 	if (key_sort_) {
@@ -1236,15 +4074,111 @@ void Ini::enableKeySort(bool enable)
 	key_sort_ = enable;
 }
 
+void Ini::enableLazyParse(bool enable)
+{
+	store_->lazy = enable;
+}
+
+void Ini::setDurability(Durability durability)
+{
+	store_->durability = durability;
+}
+
+Ini::Durability Ini::durability() const
+{
+	return store_->durability;
+}
+
+int Ini::subscribe(const QString& keyOrGroupPrefix, IniChangeCb callback)
+{
+	return store_->subscribe(this, keyOrGroupPrefix, callback);
+}
+
+void Ini::unsubscribe(int id)
+{
+	store_->unsubscribe(this, id);
+}
+
+IniStats Ini::stats() const
+{
+	IniStats result;
+	for (int i = 0; i < IniStats::OperationCount; ++i) {
+		stats_->operations[i].snapshot(result.operations[i]);
+	}
+
+	for (int i = 0; i < IniStats::MutexCount; ++i) {
+		stats_->mutexes[i].snapshot(result.mutexes[i]);
+	}
+
+	result.encryptCalls = stats_->encrypt_calls;
+	result.encryptTime = stats_->encrypt_time;
+	result.decryptCalls = stats_->decrypt_calls;
+	result.decryptTime = stats_->decrypt_time;
+	result.decryptCacheHits = stats_->decrypt_cache_hits;
+	result.decryptCacheMisses = stats_->decrypt_cache_misses;
+
+	const auto& io = store_->stats;
+	result.fileReads = io.file_reads;
+	result.bytesRead = io.bytes_read;
+	result.fileWrites = io.file_writes;
+	result.bytesWritten = io.bytes_written;
+	result.parses = io.parses;
+	result.cacheHits = io.cache_hits;
+	result.cacheMisses = io.cache_misses;
+	return result;
+}
+
+void Ini::resetStats()
+{
+	for (auto& x : stats_->operations) {
+		x.reset();
+	}
+
+	for (auto& x : stats_->mutexes) {
+		x.reset();
+	}
+
+	stats_->encrypt_calls = 0;
+	stats_->encrypt_time = 0;
+	stats_->decrypt_calls = 0;
+	stats_->decrypt_time = 0;
+	stats_->decrypt_cache_hits = 0;
+	stats_->decrypt_cache_misses = 0;
+}
+
+void Ini::enableLockStats(bool enable)
+{
+	for (auto& x : stats_->mutexes) {
+		x.enabled = enable;
+	}
+}
+
+#ifdef LIBINI_TRACE
+bool Ini::saveTrace(const QString& filePath)
+{
+	return ini::Tracer::instance().save(filePath);
+}
+#endif
+
+void Ini::enableJournal(bool enable, qint64 compactSize, double compactRatio)
+{
+	store_->compact_size = compactSize;
+	store_->compact_ratio = compactRatio;
+	store_->journaling = enable;
+	if (!enable) {
+		store_->flush(true);
+	}
+}
+
 int Ini::ctxCount() const
 {
-	QMutexLocker locker(&ctx_mutex_);
+	ini::ProfiledLocker locker(&ctx_mutex_, stats_->mutexes[IniStats::ContextMutex], __FUNCTION__);
 	return ctx_map_.count();
 }
 
 bool Ini::contains(const QString& key, int flag) const
 {
-	QMutexLocker locker(recursive_mutex_);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
 
 	QString groupName;
 	QString keyName;
@@ -1400,6 +4334,9 @@ void Ini::destroyCrypt()
 
 QString Ini::encryptData(const QString& data) const
 {
+	INI_TRACE_SCOPE(__FUNCTION__);
+	QElapsedTimer timer;
+	timer.start();
 	QString result;
 	auto byte = data.toUtf8();
 	DWORD size = byte.size();
@@ -1428,11 +4365,16 @@ RENEW_MEMORY:
 		result = QString::fromStdString(base64Encode(buf, size));
 	}
 	delete[] buf;
+	++stats_->encrypt_calls;
+	stats_->encrypt_time += timer.nsecsElapsed();
 	return result;
 }
 
 QString Ini::decryptData(const QString& data) const
 {
+	INI_TRACE_SCOPE(__FUNCTION__);
+	QElapsedTimer timer;
+	timer.start();
 	QString result;
 	auto vec = base64Decode(data.toStdString());
 	if (vec.size() != 0) {
@@ -1456,72 +4398,528 @@ QString Ini::decryptData(const QString& data) const
 		}
 		delete[] buf;
 	}
-	else {
-		result = data;
+	else {
+		result = data;
+	}
+	++stats_->decrypt_calls;
+	stats_->decrypt_time += timer.nsecsElapsed();
+	return result;
+}
+
+QVector<QPair<QString, QString>> Ini::childProperties(const QString& group) const
+{
+	QVector<QPair<QString, QString>> result;
+	QVector<int> undecrypted;      // δܽ±
+	auto& f = store_->ini;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto section = f.doc.section(group, false);
+	if (section) {
+		result.reserve(section->entries.size());
+		for (auto& x : section->entries) {
+			if (x.key.isEmpty()) {
+				continue;
+			}
+
+			if (encrypt_data_ && x.decrypted) {
+				++stats_->decrypt_cache_hits;
+				result.append(qMakePair(QString(x.key).replace("\\", "/"), x.plain));
+			}
+			else {
+				if (encrypt_data_) {
+					++stats_->decrypt_cache_misses;
+					undecrypted.append(result.size());
+				}
+				result.append(qMakePair(QString(x.key).replace("\\", "/"), f.doc.detach(x)));
+			}
+		}
+	}
+	fileUnlock();
+
+	if (undecrypted.isEmpty()) {
+		return result;
+	}
+
+	QVector<QString> raws;
+	raws.reserve(undecrypted.size());
+	for (auto i : undecrypted) {
+		raws.append(result[i].second);
+		result[i].second = decryptData(result[i].second);
+	}
+
+	fileLock(__FUNCTION__);
+	for (int i = 0; i < undecrypted.size(); ++i) {
+		const auto& x = result[undecrypted[i]];
+		auto e = f.doc.entry(group, QString(x.first).replace('/', '\\'));
+		if (e && !e->borrowed && e->value == raws[i]) {
+			e->plain = x.second;
+			e->decrypted = true;
+		}
+	}
+	fileUnlock();
+	return result;
+}
+
+QString Ini::ctxPath(bool index, QString* path) const
+{
+	// ǰ׺ƴӺ, һΪ, Ϊڵļ·
+	auto c = ctx();
+	auto full = c->group;
+	if (!c->arrayPrefix.isEmpty()) {
+		full = full.isEmpty() ? c->arrayPrefix : full + "/" + c->arrayPrefix;
+		if (index && c->arrayIndex != -1) {
+			full += "/" + QString::number(c->arrayIndex + 1);
+		}
+	}
+
+	auto slash = full.indexOf('/');
+	if (slash == -1) {
+		path->clear();
+		return full;
+	}
+
+	*path = full.mid(slash + 1);
+	return full.left(slash);
+}
+
+QStringList Ini::sectionKeys(const QString& group) const
+{
+	QStringList result;
+	auto& f = store_->ini;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto section = f.doc.section(group);
+	if (section) {
+		result.reserve(section->entries.size());
+		for (const auto& x : section->entries) {
+			if (!x.key.isEmpty()) {
+				result.append(QString(x.key).replace("\\", "/"));
+			}
+		}
+	}
+	if (!store_->layers.isEmpty()) {
+		result = ini::unite(store_->base.keys(group, QStringView()), result);
+	}
+	fileUnlock();
+	return result;
+}
+
+QStringList Ini::pathChildren(const QString& group, const QString& path, bool groups) const
+{
+	auto& f = store_->ini;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto result = f.doc.children(group, path, groups);
+	if (!store_->layers.isEmpty()) {
+		result = ini::unite(store_->base.children(group, path, groups), result);
+	}
+	fileUnlock();
+	return result;
+}
+
+QStringList Ini::pathKeys(const QString& group, const QString& path, const QString& filePath) const
+{
+	auto& f = store_->file(filePath);
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto result = f.doc.keys(group, path);
+	if (&f == &store_->ini && !store_->layers.isEmpty()) {
+		result = ini::unite(store_->base.keys(group, path), result);
+	}
+	fileUnlock();
+	return result;
+}
+
+int Ini::pathArraySize(const QString& group, const QString& path) const
+{
+	auto& f = store_->ini;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto result = f.doc.arraySize(group, path);
+	if (result == -1 && !store_->layers.isEmpty()) {
+		result = store_->base.arraySize(group, path);
+	}
+	fileUnlock();
+	return result;
+}
+
+bool Ini::pathIsGroup(const QString& group, const QString& path) const
+{
+	auto& f = store_->ini;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto result = f.doc.isGroup(group, path);
+	if (!result && !store_->layers.isEmpty()) {
+		result = store_->base.isGroup(group, path);
+	}
+	fileUnlock();
+	return result;
+}
+
+QStringList Ini::sectionNames(const QString& filePath) const
+{
+	auto& f = store_->file(filePath);
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto result = f.doc.sectionNames();
+	if (&f == &store_->ini && !store_->layers.isEmpty()) {
+		result = ini::unite(store_->base.sectionNames(), result);
+	}
+	fileUnlock();
+	return result;
+}
+
+void Ini::setLayers(const QStringList& filePaths)
+{
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	QStringList paths;
+	for (const auto& x : filePaths) {
+		paths.append(QString(x).replace("\\", "/"));
+	}
+
+	fileLock(__FUNCTION__);
+	store_->setLayers(paths);
+	fileUnlock();
+}
+
+void Ini::setFragmentDir(const QString& dirPath)
+{
+	// ļ, Ƭθǰ
+	QDir dir(dirPath);
+	QStringList paths;
+	for (const auto& x : dir.entryList(QStringList() << "*.ini", QDir::Files, QDir::Name)) {
+		paths.append(dir.absoluteFilePath(x));
+	}
+	setLayers(paths);
+}
+
+QString Ini::provenance(const QString& key) const
+{
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+
+	QString groupName;
+	QString keyName;
+	buildGroupAndKeyName(key, groupName, keyName);
+
+	if (groupName.isEmpty()) {
+		groupName = "General";
+		keyName = key;
+	}
+
+	QString result;
+	auto& f = store_->ini;
+	auto wkey = keyName.replace('/', '\\');
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	if (f.doc.entry(groupName, wkey)) {
+		result = ini_file_;
+	}
+	else if (!store_->layers.isEmpty()) {
+		auto e = store_->base.entry(groupName, wkey);
+		if (e && e->origin != -1) {
+			result = store_->layers[e->origin].path;
+		}
+	}
+	fileUnlock();
+	return result;
+}
+
+IniDiff Ini::diff(const Ini& other) const
+{
+	INI_TRACE_SCOPE(__FUNCTION__);
+	// ĵʽ, ֻü, Ƚʱκ, ʵȽҲ
+	auto snapshot = [](const Ini& x, ini::Document& values, ini::Document& comments) {
+		ini::ProfiledLocker locker(x.recursive_mutex_, x.stats_->mutexes[IniStats::InstanceMutex], "Ini::diff");
+		x.fileLock("Ini::diff");
+		x.store_->refresh(x.store_->ini);
+		x.store_->refresh(x.store_->comment);
+		values = x.store_->ini.doc;
+		comments = x.store_->comment.doc;
+		x.fileUnlock();
+	};
+
+	ini::Document values, comments, otherValues, otherComments;
+	snapshot(*this, values, comments);
+	snapshot(other, otherValues, otherComments);
+
+	IniDiff result;
+	ini::compare(values, otherValues, result.added, result.changed, result.removed, &result.addedSections, &result.removedSections);
+	ini::compare(comments, otherComments, result.comments, result.comments, result.removedComments);
+	return result;
+}
+
+bool Ini::applyPatch(const IniDiff& patch)
+{
+	INI_TRACE_SCOPE(__FUNCTION__);
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+
+	auto& values = store_->ini;
+	auto& comments = store_->comment;
+	fileLock(__FUNCTION__);
+	store_->refresh(values);
+	store_->refresh(comments);
+	for (const auto& x : patch.removed) {
+		store_->remove(values, x.group, QString(x.key).replace('/', '\\'));
+	}
+	for (const auto& x : patch.removedSections) {
+		// ɾ, ɾµĽͷڵע
+		store_->remove(values, x, QString());
+		store_->remove(comments, x, QString());
+	}
+	for (const auto& x : patch.addedSections) {
+		store_->addSection(values, x);
+	}
+	for (const auto& x : patch.added) {
+		store_->setValue(values, x.group, QString(x.key).replace('/', '\\'), x.value);
+	}
+	for (const auto& x : patch.changed) {
+		store_->setValue(values, x.group, QString(x.key).replace('/', '\\'), x.value);
+	}
+	for (const auto& x : patch.removedComments) {
+		store_->remove(comments, x.group, QString(x.key).replace('/', '\\'));
+	}
+	for (const auto& x : patch.comments) {
+		store_->setValue(comments, x.group, QString(x.key).replace('/', '\\'), x.value);
+	}
+	fileUnlock();
+
+	if (update_depth_ == 0) {
+		return commit();
+	}
+	return true;
+}
+
+QStringList Ini::layers() const
+{
+	QStringList result;
+	fileLock(__FUNCTION__);
+	for (const auto& x : store_->layers) {
+		result.append(x.path);
+	}
+	fileUnlock();
+	return result;
+}
+
+void Ini::load() const
+{
+	fileLock(__FUNCTION__);
+	store_->refresh(store_->ini);
+	store_->refresh(store_->comment);
+	fileUnlock();
+
+	if (!encrypt_data_) {
+		return;
+	}
+
+	// ԤȽֵ, ֮Ķȡֱʹû
+	for (const auto& x : sectionNames(ini_file_)) {
+		childProperties(x);
+	}
+}
+
+Ini::Ctx* Ini::ctx() const
+{
+	ini::ProfiledLocker locker(&ctx_mutex_, stats_->mutexes[IniStats::ContextMutex], __FUNCTION__);
+	Qt::HANDLE threadId = QThread::currentThreadId();
+	return &ctx_map_[threadId];
+}
+
+void Ini::clearCtx()
+{
+	auto tid = QThread::currentThreadId();
+	ini::ProfiledLocker locker(&ctx_mutex_, stats_->mutexes[IniStats::ContextMutex], __FUNCTION__);
+	if (ctx_map_.contains(tid)) {
+		ctx_map_.remove(tid);
+	}
+}
+
+void Ini::fileLock(const char* site) const
+{
+	INI_TRACE_SCOPE("fileLock");
+	auto& profile = stats_->mutexes[IniStats::FileMutex];
+	if (!profile.enabled) {
+		store_->mutex.lock();
+		return;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	store_->mutex.lock();
+	profile.acquired(site, timer.nsecsElapsed());
+}
+
+void Ini::fileUnlock() const
+{
+	// л״̬, δͳƼʱreleasingκ
+	stats_->mutexes[IniStats::FileMutex].releasing();
+	store_->mutex.unlock();
+}
+
+void Ini::attachStore()
+{
+	std::lock_guard<std::mutex> lock(ini::mutex);
+	auto& context = ini::file_lock[ini_file_];
+	if (!context.store) {
+		context.store = std::make_shared<ini::Store>(ini_file_, comment_file_);
+	}
+	++context.counter;
+	store_ = context.store;
+	//DBG_PRINT << "add" << ini_file_ << "counter" << context.counter;
+}
+
+void Ini::detachStore()
+{
+	if (!store_) {
+		return;
+	}
+
+	store_->unsubscribe(this);
+
+	// дδд̵޸
+	flush();
+	auto store = std::move(store_);
+	auto last = false;
+	{
+		std::lock_guard<std::mutex> lock(ini::mutex);
+		last = --ini::file_lock[ini_file_].counter == 0;
+	}
+
+	// һʵرʱ־ϲINIļ. ϲǰӳеĿ,
+	// ڼͬһ·ʵʹøĵ, ĵ֮ͬʱд
+	if (last) {
+		store->flush(true);
+
+		std::lock_guard<std::mutex> lock(ini::mutex);
+		auto it = ini::file_lock.find(ini_file_);
+		if (it != ini::file_lock.end() && it->second.counter == 0) {
+			ini::file_lock.erase(it);
+			//DBG_PRINT << "remove" << ini_file_;
+		}
+		else {
+			last = false;
+		}
+	}
+
+	if (last && store->notifying()) {
+		// ڻصһʵ, ߳ͷ, ̵֪ͨ߳ȴ˳
+		std::thread([store = std::move(store)]() mutable {
+			store.reset();
+		}).detach();
+	}
+}
+
+bool Ini::flush() const
+{
+	return store_->flush();
+}
+
+bool Ini::commit() const
+{
+	if (store_->subscribed()) {
+		// һύе޸ĺϲΪһ֪ͨ
+		fileLock(__FUNCTION__);
+		store_->publish();
+		fileUnlock();
+	}
+
+	if (async_write_) {
+		store_->schedule();
+		return true;
+	}
+	return store_->flush();
+}
+
+bool Ini::sync()
+{
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	auto result = store_->flush(true);
+
+	for (auto f : { &store_->ini, &store_->comment }) {
+		fileLock(__FUNCTION__);
+		f->checked.invalidate();
+		store_->refresh(*f);
+		fileUnlock();
+	}
+	return result;
+}
+
+void Ini::enableFileLock(bool enable, int timeout)
+{
+	store_->lock_timeout = timeout;
+	store_->locking = enable;
+}
+
+bool Ini::acquireFileLock(bool exclusive, int timeout)
+{
+	auto mode = exclusive ? ini::FileLock::Mode::Exclusive : ini::FileLock::Mode::Shared;
+	if (!store_->file_lock.lock(mode, timeout, true)) {
+		return false;
+	}
+
+	// ڼ޷д, ͬϵ
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	for (auto f : { &store_->ini, &store_->comment }) {
+		fileLock(__FUNCTION__);
+		f->checked.invalidate();
+		store_->refresh(*f);
+		fileUnlock();
 	}
-	return result;
+	return true;
 }
 
-QVector<QPair<QString, QString>> Ini::childProperties(const QString& group) const
+bool Ini::tryAcquireFileLock(bool exclusive)
 {
-	QVector<QPair<QString, QString>> result;
-	size_t size = 4096;
-	std::unique_ptr<wchar_t[]> buffer = nullptr;
+	return acquireFileLock(exclusive, 0);
+}
 
-REALLOCATE_MEMORY0:
-	buffer.reset(new wchar_t[size]);
-	memset(buffer.get(), 0x00, size * sizeof(wchar_t));
+void Ini::releaseFileLock()
+{
+	store_->file_lock.unlock(true);
 
-	auto app = group.toStdWString();
-	fileLock();
-	auto length = GetPrivateProfileSection(app.c_str(), buffer.get(), size, ini_file_.toStdWString().c_str());
-	fileUnlock();
-	if (length == size - 2) {
-		size *= 2;
-		buffer.reset();
-		goto REALLOCATE_MEMORY0;
-	}
+	// дйڼ޷д̵޸
+	flush();
+}
 
-	auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-	for (const auto& y : split0) {
-		auto index = y.indexOf("=");
-		if (index != -1) {
-			auto key = y.mid(0, index).replace("\\", "/");
-			auto value = y.mid(index + 1);
-			if (encrypt_data_) {
-				value = decryptData(value);
-			}
-			result.append(qMakePair(key, value));
-		}
+void Ini::enableAsyncWrite(bool enable, int delay)
+{
+	ini::ProfiledLocker locker(recursive_mutex_, stats_->mutexes[IniStats::InstanceMutex], __FUNCTION__);
+	store_->write_delay = delay;
+	async_write_ = enable;
+	if (!enable) {
+		flush();
 	}
-
-	return result;
 }
 
-Ini::Ctx* Ini::ctx() const
+QFuture<bool> Ini::flushAsync()
 {
-	QMutexLocker locker(&ctx_mutex_);
-	Qt::HANDLE threadId = QThread::currentThreadId();
-	return &ctx_map_[threadId];
+	QFutureInterface<bool> waiter;
+	waiter.reportStarted();
+	auto future = waiter.future();
+	store_->schedule(&waiter);
+	return future;
 }
 
-void Ini::clearCtx()
+bool Ini::waitForFlush(int timeout)
 {
-	auto tid = QThread::currentThreadId();
-	QMutexLocker locker(&ctx_mutex_);
-	if (ctx_map_.contains(tid)) {
-		ctx_map_.remove(tid);
-	}
+	return store_->waitForFlush(timeout);
 }
 
-void Ini::fileLock() const
+QFuture<QSharedPointer<Ini>> Ini::openAsync(const QString& filePath, bool encryptData)
 {
-	ini::file_lock[ini_file_].lock();
+	return QtConcurrent::run([filePath, encryptData]() {
+		QSharedPointer<Ini> ini(new Ini(filePath, encryptData));
+		ini->load();
+		return ini;
+	});
 }
 
-void Ini::fileUnlock() const
+QFuture<void> Ini::preload() const
 {
-	ini::file_lock[ini_file_].unlock();
+	// ʹø, ǰǰʵѱ
+	QSharedPointer<Ini> ini(new Ini(*this));
+	return QtConcurrent::run([ini]() {
+		ini->load();
+	});
 }
 
 QString Ini::fastRead(const QString& group, const QString& key, const QString& defaultValue) const
@@ -1536,12 +4934,15 @@ void Ini::fastWrite(const QString& group, const QString& key, const QString& val
 
 void Ini::fastRemove(const QString& group, const QString& key) const
 {
+	UpdateLocker updater(this);
 	removeFileData(group, key, ini_file_);
 	removeFileData(group, key, comment_file_);
 }
 
 void Ini::fastRename(const QString& group, const QString& oldKeyPath, const QString& newKeyName)
 {
+	UpdateLocker updater(this);
+
 	// bug
 	auto func = [&](const QString& filePath) {
 		auto result = false;
@@ -1570,39 +4971,67 @@ void Ini::fastRename(const QString& group, const QString& oldKeyPath, const QStr
 	func(comment_file_);
 }
 
-QString Ini::readFileData(const QString& group, const QString& key, const QString& defaultValue, const QString& filePath, bool* result) const
+QString Ini::readFileData(QStringView group, QStringView key, const QString& defaultValue, const QString& filePath, bool* result) const
 {
-	QFileInfo fi(filePath);
-	if (!fi.exists()) {
+	auto& f = store_->file(filePath);
+	QString path;
+	auto wkey = key;
+	if (key.indexOf('/') != -1) {
+		path = key.toString().replace('/', '\\');
+		wkey = path;
+	}
+	auto decrypt = encrypt_data_ && (filePath == ini_file_);
+
+	// ĵΪ׼, INIļδд(ֻд־ȴ̨д)ʱҲܶ޸
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	auto doc = &f.doc;
+	auto entry = f.doc.entry(group, wkey);
+	if (!entry && &f == &store_->ini && !store_->layers.isEmpty()) {
+		// ϲδʱʹ²ϲֵ
+		doc = &store_->base;
+		entry = doc->entry(group, wkey);
+	}
+	auto find = entry != nullptr;
+	auto cached = false;
+	QString raw, value;
+	if (find) {
+		raw = doc->detach(*entry);
+		if (decrypt && entry->decrypted) {
+			value = entry->plain;
+			cached = true;
+			++stats_->decrypt_cache_hits;
+		}
+	}
+	fileUnlock();
+
+	if (!find) {
 		if (result) {
 			*result = false;
 		}
 		return defaultValue;
 	}
 
-	size_t size = 4096;
-	std::unique_ptr<wchar_t[]> buffer;
-
-REALLOCATE_MEMORY:
-	buffer.reset(new wchar_t[size]);
-	memset(buffer.get(), 0x00, size * sizeof(wchar_t));
-
-	auto wkey = key.toStdWString();
-	std::replace_if(wkey.begin(), wkey.end(), [](wchar_t c) { return c == L'/'; }, L'\\');
+	if (!cached) {
+		value = raw;
+		if (value.size() >= 2 && (value.startsWith('"') || value.startsWith('\'')) && value.endsWith(value.at(0))) {
+			// GetPrivateProfileStringһ, ȥɶԵ
+			value = value.mid(1, value.size() - 2);
+		}
 
-	fileLock();
-	auto length = GetPrivateProfileString(group.toStdWString().c_str(), wkey.c_str(),
-		defaultValue.toStdWString().c_str(), buffer.get(), size, filePath.toStdWString().c_str());
-	fileUnlock();
-	if (length == -1) {
-		size *= 2;
-		buffer.reset();
-		goto REALLOCATE_MEMORY;
-	}
+		if (decrypt && !value.isEmpty()) {
+			++stats_->decrypt_cache_misses;
+			value = decryptData(value);
 
-	auto value = QString::fromWCharArray(buffer.get());
-	if (encrypt_data_ && !value.isEmpty() && (filePath == ini_file_)) {
-		value = decryptData(value);
+			// ܽ, Ŀѱ߳޸ʱ
+			fileLock(__FUNCTION__);
+			auto e = doc->entry(group, wkey);
+			if (e && !e->borrowed && e->value == raw) {
+				e->plain = value;
+				e->decrypted = true;
+			}
+			fileUnlock();
+		}
 	}
 
 	if (result) {
@@ -1613,102 +5042,501 @@ REALLOCATE_MEMORY:
 
 bool Ini::writeFileData(const QString& group, const QString& key, const QString& value, const QString& filePath) const
 {
-	std::wstring wstr;
+	QString str;
 	if (encrypt_data_ && !value.isEmpty() && (filePath == ini_file_)) {
-		wstr = encryptData(value).toStdWString();
+		str = encryptData(value);
 	}
 	else {
-		wstr = value.toStdWString();
+		str = value;
 	}
 
-	auto wkey = key.toStdWString();
-	std::replace_if(wkey.begin(), wkey.end(), [](wchar_t c) { return c == L'/'; }, L'\\');
+	auto wkey = QString(key).replace('/', '\\');
 
-	auto result = FALSE;
-	fileLock();
-	result = WritePrivateProfileStringW(group.toStdWString().c_str(), wkey.c_str(), wstr.c_str(), filePath.toStdWString().c_str());
+	auto& f = store_->file(filePath);
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	store_->setValue(f, group, wkey, str);
 	fileUnlock();
-	return result;
+
+	if (update_depth_ == 0) {
+		return commit();
+	}
+	return true;
 }
 
 bool Ini::removeFileData(const QString& group, const QString& key, const QString& filePath) const
 {
-	QFileInfo fi(filePath);
-	if (!fi.exists()) {
-		return false;
+	auto& f = store_->file(filePath);
+	auto result = false;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	if (!group.isEmpty()) {
+		result = store_->remove(f, group, QString(key).replace('/', '\\'));
 	}
+	fileUnlock();
 
-	auto result = FALSE;
-	if (!group.isEmpty() && !key.isEmpty()) {
-		auto wkey = key.toStdWString();
-		std::replace_if(wkey.begin(), wkey.end(), [](wchar_t c) { return c == L'/'; }, L'\\');
-		fileLock();
-		result = WritePrivateProfileStringW(group.toStdWString().c_str(), wkey.c_str(), nullptr, filePath.toStdWString().c_str());
-		fileUnlock();
+	if (result && update_depth_ == 0) {
+		return commit();
 	}
-	else if (!group.isEmpty() && key.isEmpty()) {
-		fileLock();
-		result = WritePrivateProfileStringW(group.toStdWString().c_str(), nullptr, nullptr, filePath.toStdWString().c_str());
-		fileUnlock();
+	return result;
+}
+
+bool Ini::removePathData(const QString& group, const QString& path, const QString& filePath) const
+{
+	auto& f = store_->file(filePath);
+	auto result = false;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	if (!group.isEmpty()) {
+		result = store_->removePath(f, group, QString(path).replace('/', '\\'));
 	}
+	fileUnlock();
 
-	return result == TRUE;
+	if (result && update_depth_ == 0) {
+		return commit();
+	}
+	return result;
 }
 
-bool Ini::containsFileData(const QString& group, const QString& key, const QString& filePath) const
+int Ini::movePathData(const QString& group, const QString& path, const QString& toGroup, const QString& toPath,
+	Conflict conflict, const QString& filePath, QVector<QPair<QString, QString>>* moved) const
 {
-	QFileInfo fi(filePath);
-	if (!fi.exists()) {
-		return false;
+	auto& f = store_->file(filePath);
+	auto result = 0;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	result = store_->movePath(f, group, QString(path).replace('/', '\\'), toGroup, QString(toPath).replace('/', '\\'), conflict, moved);
+	fileUnlock();
+
+	if (result > 0 && update_depth_ == 0) {
+		commit();
 	}
+	return result;
+}
 
-	bool result = false;
-	if (key.isEmpty()) {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer;
-	REALLOCATE_MEMORY0:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0, size * sizeof(wchar_t));
-		fileLock();
-		auto length = GetPrivateProfileSectionNames(buffer.get(), size, ini_file_.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY0;
+void Ini::moveComments(const QString& group, const QString& toGroup, const QString& toPath,
+	const QVector<QPair<QString, QString>>& moved, bool replace) const
+{
+	auto& f = store_->comment;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+
+	// ȡɾԴע, ԴĿͬʱҲụา
+	QHash<int, QString> comments;
+	for (int i = 0; i < moved.size(); ++i) {
+		auto e = f.doc.entry(group, moved[i].first);
+		if (e) {
+			comments.insert(i, f.doc.text(*e));
+			store_->remove(f, group, moved[i].first);
+		}
+	}
+
+	// Ŀ·滻ʱ, ԭеעһɾ
+	if (replace) {
+		auto to = QString(toPath).replace('/', '\\');
+		if (to.isEmpty()) {
+			store_->remove(f, toGroup, QString());
+		}
+		else {
+			store_->removePath(f, toGroup, to);
+			if (f.doc.entry(toGroup, to)) {
+				store_->remove(f, toGroup, to);
+			}
+		}
+	}
+
+	// Ŀֵѱ, ԭеע֮滻ɾ
+	for (int i = 0; i < moved.size(); ++i) {
+		if (comments.contains(i)) {
+			store_->setValue(f, toGroup, moved[i].second, comments[i]);
 		}
+		else if (f.doc.entry(toGroup, moved[i].second)) {
+			store_->remove(f, toGroup, moved[i].second);
+		}
+	}
+	fileUnlock();
+
+	if (!moved.isEmpty() && update_depth_ == 0) {
+		commit();
+	}
+}
+
+bool Ini::containsFileData(QStringView group, QStringView key, const QString& filePath) const
+{
+	auto& f = store_->file(filePath);
+	QString path;
+	auto wkey = key;
+	if (key.indexOf('/') != -1) {
+		path = key.toString().replace('/', '\\');
+		wkey = path;
+	}
 
-		auto split = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		result = split.contains(group, Qt::CaseInsensitive);
+	bool result = false;
+	fileLock(__FUNCTION__);
+	store_->refresh(f);
+	if (key.isEmpty()) {
+		auto& i = store_->ini;
+		store_->refresh(i);
+		result = i.doc.section(group) != nullptr;
 	}
 	else {
-		size_t size = 4096;
-		std::unique_ptr<wchar_t[]> buffer = nullptr;
+		result = f.doc.value(group, wkey, nullptr);
+	}
 
-	REALLOCATE_MEMORY1:
-		buffer.reset(new wchar_t[size]);
-		memset(buffer.get(), 0x00, size * sizeof(wchar_t));
+	if (!result && &f == &store_->ini && !store_->layers.isEmpty()) {
+		result = key.isEmpty() ? store_->base.section(group) != nullptr :
+			store_->base.value(group, wkey, nullptr);
+	}
+	fileUnlock();
+	return result;
+}
 
-		fileLock();
-		auto length = GetPrivateProfileSection(group.toStdWString().c_str(), buffer.get(), size, filePath.toStdWString().c_str());
-		fileUnlock();
-		if (length == size - 2) {
-			size *= 2;
-			buffer.reset();
-			goto REALLOCATE_MEMORY1;
-		}
-
-		bool find = false;
-		auto split0 = QString::fromWCharArray(buffer.get(), length).split(QChar(0x00), QString::SkipEmptyParts);
-		for (const auto& x : split0) {
-			auto split = x.split("=", QString::SkipEmptyParts);
-			if (split.size() != 0 && split[0].replace("\\", "/").compare(key, Qt::CaseInsensitive) == 0) {
-				find = true;
-				break;
+IniReader::IniReader(int chunkSize)
+	: chunk_size_(std::max<int>(chunkSize, 4096))
+{
+}
+
+bool IniReader::read(QIODevice* device, IniReaderCb callback) const
+{
+	INI_TRACE_SCOPE(__FUNCTION__);
+	if (!device || !device->isReadable() || !callback) {
+		return false;
+	}
+
+	IniEvent event;
+	auto inSection = false;
+
+	// һ, falseʱֹͣȡ. utf8ΪfalseʱʶUTF-8뱾ر
+	auto parse = [&](const char* first, const char* last, bool utf8) {
+		++event.line;
+		ini::trim(first, last);
+		if (first == last) {
+			return true;
+		}
+
+		auto decode = [utf8](const char* begin, const char* end) {
+			auto size = static_cast<int>(end - begin);
+			return utf8 || ini::isUtf8(QByteArray::fromRawData(begin, size)) ?
+				QString::fromUtf8(begin, size) : QString::fromLocal8Bit(begin, size);
+		};
+
+		event.key.clear();
+		event.value.clear();
+		event.arrayPrefix.clear();
+		event.arrayIndex = -1;
+		if (*first == '[') {
+			auto close = static_cast<const char*>(memchr(first, ']', last - first));
+			auto nameBegin = first + 1;
+			auto nameEnd = close ? close : last;
+			ini::trim(nameBegin, nameEnd);
+			event.type = IniEvent::Section;
+			event.group = decode(nameBegin, nameEnd);
+			inSection = true;
+			return callback(event);
+		}
+
+		if (!inSection) {
+			// һ֮ǰIniҲ޷
+			return true;
+		}
+
+		if (*first == ';') {
+			event.type = IniEvent::Comment;
+			event.value = decode(first + 1, last);
+			return callback(event);
+		}
+
+		auto equal = static_cast<const char*>(memchr(first, '=', last - first));
+		auto keyBegin = first;
+		auto keyEnd = equal ? equal : first;
+		ini::trim(keyBegin, keyEnd);
+		if (keyBegin == keyEnd) {
+			// Ǽֵ, Iniԭ
+			return true;
+		}
+
+		auto valueBegin = equal + 1;
+		auto valueEnd = last;
+		ini::trim(valueBegin, valueEnd);
+		event.type = IniEvent::Value;
+		event.key = decode(keyBegin, keyEnd).replace('\\', '/');
+		event.value = decode(valueBegin, valueEnd);
+		if (event.value.size() >= 2 && (event.value.startsWith('"') || event.value.startsWith('\'')) && event.value.endsWith(event.value.at(0))) {
+			event.value = event.value.mid(1, event.value.size() - 2);
+		}
+
+		// beginWriteArrayдĸʽһ: ·//
+		auto lastSlash = event.key.lastIndexOf('/');
+		if (lastSlash > 0) {
+			auto prevSlash = event.key.lastIndexOf('/', lastSlash - 1);
+			auto number = ini::elementNumber(QStringView(event.key).mid(prevSlash + 1, lastSlash - prevSlash - 1));
+			if (number > 0) {
+				event.arrayIndex = number - 1;
+				event.arrayPrefix = prevSlash == -1 ? event.group : event.group + "/" + event.key.left(prevSlash);
+			}
+		}
+		return callback(event);
+	};
+
+	std::unique_ptr<QTextDecoder> decoder;     // UTF-16ļĽ
+	QByteArray pending;                        // δеֽ
+	QString text;                              // UTF-16ļδеַ
+	auto checked = false;                      // ǷѼBOM
+	auto eof = false;
+	while (!eof) {
+		auto data = device->read(chunk_size_);
+		if (data.isEmpty()) {
+			// ܵ˳豸ʱûʱȴ, ʱ
+			if (device->isSequential() && device->waitForReadyRead(-1)) {
+				continue;
+			}
+			eof = true;
+		}
+
+		if (!checked) {
+			pending += data;
+			if (pending.size() < 3 && !eof) {
+				continue;
+			}
+
+			checked = true;
+			if (pending.startsWith("\xff\xfe")) {
+				decoder.reset(QTextCodec::codecForName("UTF-16LE")->makeDecoder());
+				pending.remove(0, 2);
+			}
+			else if (pending.startsWith("\xef\xbb\xbf")) {
+				pending.remove(0, 3);
+			}
+			data = std::move(pending);
+			pending.clear();
+		}
+
+		if (decoder) {
+			text += decoder->toUnicode(data);
+			int pos = 0;
+			for (int eol; (eol = text.indexOf('\n', pos)) != -1; pos = eol + 1) {
+				auto line = QStringView(text).mid(pos, eol - pos).toUtf8();
+				if (!parse(line.constData(), line.constData() + line.size(), true)) {
+					return false;
+				}
+			}
+			text.remove(0, pos);
+
+			if (eof && !text.isEmpty()) {
+				auto line = text.toUtf8();
+				if (!parse(line.constData(), line.constData() + line.size(), true)) {
+					return false;
+				}
+			}
+		}
+		else {
+			pending += data;
+			int pos = 0;
+			for (int eol; (eol = pending.indexOf('\n', pos)) != -1; pos = eol + 1) {
+				if (!parse(pending.constData() + pos, pending.constData() + eol, false)) {
+					return false;
+				}
+			}
+			pending.remove(0, pos);
+
+			if (eof && !pending.isEmpty()) {
+				if (!parse(pending.constData(), pending.constData() + pending.size(), false)) {
+					return false;
+				}
 			}
 		}
-		result = find;
 	}
+	return true;
+}
+
+QMap<QString, QString> IniReader::extract(QIODevice* device, const QStringList& keyPaths) const
+{
+	QMap<QString, QString> result;
+	QHash<QString, QString> wanted;    // ۵Сд· -> ߸д
+	for (const auto& x : keyPaths) {
+		wanted.insert(QString(x).replace('\\', '/').toCaseFolded(), x);
+	}
+
+	if (wanted.isEmpty()) {
+		return result;
+	}
+
+	read(device, [&](const IniEvent& event) {
+		if (event.type != IniEvent::Value) {
+			return true;
+		}
 
+		auto it = wanted.find(QString("%1/%2").arg(event.group, event.key).toCaseFolded());
+		if (it != wanted.end()) {
+			result.insert(it.value(), event.value);
+			wanted.erase(it);
+		}
+		return !wanted.isEmpty();
+		});
 	return result;
 }
+
+QString IniWriter::encode(const Variant& value)
+{
+	INI_TRACE_SCOPE(__FUNCTION__);
+	QString str;
+	if (value.type() == QVariant::Type::StringList) {
+		auto strs = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toStringList();
+		if (!strs.isEmpty()) {
+			auto joined = "\"" + strs.join("\", \"") + "\"";
+			str = "{" + joined + "}";
+		}
+		else {
+			str = "{}";
+		}
+	}
+	else if (value.type() == QMetaType::QJsonObject) {
+		auto jsonobj = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toJsonObject();
+		QJsonDocument doc(jsonobj);
+		str = doc.toJson(QJsonDocument::Compact);
+	}
+	else if (value.type() == QMetaType::QJsonArray) {
+		auto jsonarr = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toJsonArray();
+		QJsonDocument doc(jsonarr);
+		str = doc.toJson(QJsonDocument::Compact);
+	}
+	else if (value.type() == QVariant::ByteArray) {
+		auto bytes = dynamic_cast<QVariant&>(const_cast<Variant&>(value)).toByteArray();
+		QStringList strs;
+		if (!bytes.isEmpty()) {
+			for (int i = 0; i < bytes.size(); ++i) {
+				auto uc = static_cast<uchar>(bytes[i]);
+				strs.append(QString::asprintf("0x%02x", uc));
+			}
+			str = "{" + strs.join(",") + "}";
+		}
+		else {
+			str = "{}";
+		}
+	}
+	else if (value.userType() == static_cast<int>(Variant::UserType::Range)) {
+		// QPair->range
+		auto pair = value.toRange<QString>();
+		str = QString("%1~%2").arg(pair.first, pair.second);
+	}
+	else {
+		str = value.toString();
+	}
+	return str;
+}
+
+IniWriter::IniWriter(QIODevice* device)
+	: device_(device)
+{
+	buffer_.reserve(buffer_size_);
+}
+
+IniWriter::~IniWriter()
+{
+	finish();
+}
+
+void IniWriter::setKeyOrder(KeyOrder order)
+{
+	if (key_order_ == KeyOrder::Sorted && order != KeyOrder::Sorted) {
+		endSection();
+	}
+	key_order_ = order;
+}
+
+void IniWriter::setLineEnding(LineEnding ending)
+{
+	eol_ = ending == LineEnding::CrLf ? "\r\n" : "\n";
+}
+
+void IniWriter::setBufferSize(int size)
+{
+	buffer_size_ = std::max<int>(size, 4096);
+	buffer_.reserve(buffer_size_);
+}
+
+void IniWriter::beginSection(const QString& name)
+{
+	endSection();
+	if (!first_section_) {
+		buffer_ += eol_;
+	}
+	first_section_ = false;
+	in_section_ = true;
+	buffer_ += "[" + name.toUtf8() + "]" + eol_;
+	write(buffer_size_);
+}
+
+void IniWriter::setValue(const QString& key, const Variant& value)
+{
+	INI_TRACE_SCOPE(__FUNCTION__);
+	if (!in_section_) {
+		beginSection("General");
+	}
+
+	// Iniһ, ļ\ֲ㼶
+	auto str = encode(value);
+	auto wkey = QString(key).replace('/', '\\');
+	if (key_order_ == KeyOrder::Sorted) {
+		pending_.append(qMakePair(wkey, str));
+		return;
+	}
+
+	appendValue(wkey, str);
+	write(buffer_size_);
+}
+
+bool IniWriter::flush()
+{
+	return write(0);
+}
+
+bool IniWriter::finish()
+{
+	endSection();
+	return write(0);
+}
+
+bool IniWriter::hasError() const
+{
+	return error_;
+}
+
+void IniWriter::endSection()
+{
+	if (pending_.isEmpty()) {
+		return;
+	}
+
+	// ȶ, ظļд˳, ȡʱԵһγֵΪ׼
+	std::stable_sort(pending_.begin(), pending_.end(), [](const QPair<QString, QString>& a, const QPair<QString, QString>& b) {
+		return a.first < b.first;
+		});
+	for (const auto& x : pending_) {
+		appendValue(x.first, x.second);
+		write(buffer_size_);
+	}
+	pending_.clear();
+}
+
+void IniWriter::appendValue(const QString& key, const QString& value)
+{
+	buffer_ += key.toUtf8();
+	buffer_ += '=';
+	buffer_ += value.toUtf8();
+	buffer_ += eol_;
+}
+
+bool IniWriter::write(int threshold)
+{
+	if (buffer_.size() < threshold || buffer_.isEmpty()) {
+		return !error_;
+	}
+
+	if (!device_ || device_->write(buffer_) != buffer_.size()) {
+		error_ = true;
+	}
+	// clearͷԤĿռ, resize
+	buffer_.resize(0);
+	return !error_;
+}
@@ -8,7 +8,15 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QFuture>
+#include <QSharedPointer>
 #include <functional>
+#include <memory>
+
+namespace ini {
+	class Store;
+	struct Stats;
+}
 
 /**
 * @brief չQVariant֧࣬JSONת
@@ -17,6 +25,7 @@
 class Variant : protected QVariant {
 public:
 	friend class Ini;
+	friend class IniWriter;
 
 	enum class UserType {
 		Range = QMetaType::User + 1,
@@ -104,9 +113,147 @@ private:
 
 using IniTraverseArrayCb = ::std::function<bool(int index, const QString& key, const Variant& value)>;
 
+// ޸֪ͨص, keysΪƥ䶩ĵļ(/ָ·, Generalļ)
+using IniChangeCb = ::std::function<void(const QStringList& keys)>;
+
+/*
+* @brief ʱֱͼ
+* @note 2ݴ΢Ͱ, buckets[0]Ϊ1΢, buckets[i]Ϊ[2^(i-1), 2^i)΢
+*/
+struct IniHistogram {
+	static constexpr int kBuckets = 32;
+
+	quint64 count = 0;                 // 
+	quint64 total = 0;                 // ܺʱ()
+	quint64 max = 0;                   // ʱ()
+	quint64 buckets[kBuckets] = {};    // Ĵ
+
+	/*
+	* @brief ƽʱ
+	* @return ƽʱ(΢)
+	*/
+	double mean() const;
+
+	/*
+	* @brief ٷλʱ
+	* @param percent ٷλ, 50, 99, 99.9
+	* @return ٷλϽ(΢), ʱ
+	*/
+	double percentile(double percent) const;
+};
+
+/*
+* @brief ĵȴͳ
+* @note ݹֻͳ
+*/
+struct IniLockStats {
+	// λ
+	struct Site {
+		QString name;                  // ĺ
+		quint64 count = 0;             // 
+		quint64 waitTotal = 0;         // ܵȴʱ()
+		quint64 waitMax = 0;           // ȴʱ()
+		quint64 holdTotal = 0;         // ܳʱ()
+	};
+
+	IniHistogram wait;                 // ȴʱ
+	IniHistogram hold;                 // ʱ
+	QVector<Site> sites;               // ܵȴʱ併
+};
+
+/*
+* @brief ͳ
+*/
+struct IniStats {
+	enum Operation {
+		Value,
+		SetValue,
+		Comment,
+		SetComment,
+		Contains,
+		ChildKeys,
+		ChildGroups,
+		AllKeys,
+		Remove,
+		Rename,
+		OperationCount,
+	};
+
+	enum Mutex {
+		InstanceMutex,                 // ʵĵݹ黥
+		ContextMutex,                  // ߳Ļ
+		FileMutex,                     // ͬһ·ĵ
+		MutexCount,
+	};
+
+	// Ĵʱ, OperationΪ±
+	IniHistogram operations[OperationCount];
+
+	// ʵԸĵȴͳ, MutexΪ±, ȵIni::enableLockStats
+	IniLockStats mutexes[MutexCount];
+
+	// Ϊʵļ
+	quint64 encryptCalls = 0;          // ܴ
+	quint64 encryptTime = 0;           // ܺʱ()
+	quint64 decryptCalls = 0;          // ܴ
+	quint64 decryptTime = 0;           // ܺʱ()
+	quint64 decryptCacheHits = 0;      // ȡʱнܻĴ
+	quint64 decryptCacheMisses = 0;    // ȡʱҪܵĴ
+
+	// Ϊͬһ·ʵļ, ״δۼ
+	quint64 fileReads = 0;             // ȡļ(־)Ĵ
+	quint64 bytesRead = 0;             // ȡֽ
+	quint64 fileWrites = 0;            // дļ(־)Ĵ
+	quint64 bytesWritten = 0;          // дֽ
+	quint64 parses = 0;                // ĵĴ
+	quint64 cacheHits = 0;             // ʱֱʹڴĵĴ
+	quint64 cacheMisses = 0;           // ʱҪӴ̼صĴ
+};
+
+/*
+* @brief INI֮Ĳ, Ini::diff, Ini::applyPatchӦ
+* @note ֵעΪļбԭʼı, üʱΪ, ˫ʹͬļ
+*/
+struct IniDiff {
+	struct Item {
+		QString group;                 // 
+		QString key;                   // ڵļ·, /ֲ㼶
+		QString value;                 // µֵע, ɾʱΪ
+	};
+
+	QVector<Item> added;               // ļ
+	QVector<Item> removed;             // ɾļ
+	QVector<Item> changed;             // ֵıļ
+	QVector<Item> comments;            // ıע
+	QVector<Item> removedComments;     // ɾע
+	QStringList addedSections;         // Ľ, ûκμĿս
+	QStringList removedSections;       // ɾĽ, еļͬʱremoved
+
+	inline bool isEmpty() const {
+		return added.isEmpty() && removed.isEmpty() && changed.isEmpty() &&
+			comments.isEmpty() && removedComments.isEmpty() &&
+			addedSections.isEmpty() && removedSections.isEmpty();
+	}
+};
+
 class Ini
 {
 public:
+	// д̵ĳ־û
+	enum class Durability {
+		None,       // ֱӸԭļ, , д;ļ
+		Flush,      // дʱļԭ滻, ̱ļ
+		Fsync,      // ͬFlush, 滻ǰʱļˢµ, 粻ļ
+		FsyncDir,   // ͬFsync, ˢĿ¼, 滻Ҳᶪʧ
+	};
+
+	// ƶʱĿѴڵĴʽ
+	enum class Conflict {
+		Skip,       // Ѵڵļ, ԭ, ճƶ
+		Overwrite,  // Դ滻Ŀ·, Ŀԭеһɾ, Դϲ
+		Abort,      // ĿѴʱκ޸Ĳfalse, renamemoveĬϷʽ
+	};
+
 	// RAII
 
 	// 
@@ -160,6 +307,8 @@ public:
 	 * @brief 캯
 	 * @param[in] filePath INIļ·Ϊ򴴽ڴINI
 	 * @param[in] encryptData Ƿݼ
+	 * @note WritePrivateProfileStringһ, ļ봿ASCIIļر(ANSI)д;
+	 * BOMUTF-8, ASCIIַUTF-8UTF-16ļԭб
 	 */
 	explicit Ini(const QString& filePath = QString(), bool encryptData = false);
 
@@ -284,6 +433,23 @@ public:
 	 */
 	Variant value(const QString& key, const Variant& defaultValue = Variant()) const;
 
+	/**
+	 * @brief üֵ, ΪQStringView
+	 * @param[in] key 
+	 * @param[in] value ֵ
+	 * @note δbeginGroup/beginReadArray/beginWriteArrayʱֱӰͼ, Ѵڵĵе, Ϊڴ
+	 */
+	void setValue(QStringView key, const Variant& value);
+
+	/**
+	 * @brief ȡֵ, ΪQStringView
+	 * @param[in] key 
+	 * @param[in] defaultValue Ĭֵ
+	 * @return Ӧֵ򷵻Ĭֵ
+	 * @note δbeginGroup/beginReadArray/beginWriteArrayʱֱӰͼ, Ϊڴ
+	 */
+	Variant value(QStringView key, const Variant& defaultValue = Variant()) const;
+
 	//=====================================================================
 	// עͲ
 	//=====================================================================
@@ -328,14 +494,29 @@ public:
 	void remove(const QString& key);
 
 	/**
-	 * @brief 
+	 * @brief , , עһ
 	 * @param[in] oldKeyPath ɼ·
 	 * @param[in] newKeyName ¼
+	 * @param[in] conflict ¼ѴʱĴʽ, Ĭϲκ޸
+	 * @return мtrue, 򷵻false
 	 *
 	 * ʾ:
 	 * rename("config/key0", "key"); //ڶ, key0Ϊkey, Ҫдconfig/key
 	 */
-	void rename(const QString& oldKeyPath, const QString& newKeyName);
+	bool rename(const QString& oldKeyPath, const QString& newKeyName, Conflict conflict = Conflict::Abort);
+
+	/**
+	 * @brief ƶ, , עһƶ
+	 * @param[in] fromKeyPath Դ·, /ʱΪ
+	 * @param[in] toKeyPath Ŀ·, λ, /ʱΪ
+	 * @param[in] conflict ĿѴʱĴʽ, Ĭϲκ޸
+	 * @return мƶtrue, 򷵻false
+	 *
+	 * мڴһƶ, ÿļֻдһ.
+	 * ʾ:
+	 * move("v1/network", "v2/network"); //v1еnetworkмƶv2
+	 */
+	bool move(const QString& fromKeyPath, const QString& toKeyPath, Conflict conflict = Conflict::Abort);
 
 	/**
 	 * @brief Ƿ
@@ -344,6 +525,14 @@ public:
 	 */
 	bool contains(const QString& key) const;
 
+	/**
+	 * @brief Ƿ, ΪQStringView
+	 * @param[in] key 
+	 * @return ڷtrue򷵻false
+	 * @note δbeginGroup/beginReadArray/beginWriteArrayʱֱӰͼ, Ϊڴ
+	 */
+	bool contains(QStringView key) const;
+
 	/*
 	* @brief ǷΪ
 	* @param[in] key 
@@ -386,12 +575,229 @@ public:
 	*/
 	void enableKeySort(bool enable = true);
 
+	/*
+	* @brief ӳٽ
+	* @param enable Ƿ
+	* @note úʱֻɨڵı߽, ڵļֵ״ηʸýʱŽ,
+	* ڽںܶ൫ֻڵļ. ״ζд֮ǰ, Դͬһ·ʵЧ
+	*/
+	void enableLazyParse(bool enable = true);
+
+	/*
+	* @brief ׷־д
+	* @param enable Ƿ
+	* @param compactSize ־˴С(ֽ)ʱϲINIļ
+	* @param compactRatio ־INIļСĴ˱ʱϲINIļ
+	* @note úÿдֻ޸׷ӵ<file>.journal, дINIļ, ʱԶط־.
+	* sync()ϲ־, رʱҲϲ. Դͬһ·ʵЧ
+	*/
+	void enableJournal(bool enable = true, qint64 compactSize = 1024 * 1024, double compactRatio = 0.5);
+
+	/*
+	* @brief ֻ²ļ
+	* @param filePaths ӵ͵, {Ĭ, վ}, ʵļΪϲ, Ϊʱȡֲ
+	* @note value()ϲĶ, childKeys(), childGroups()allKeys()غϲĽ, дֻ޸ϲ.
+	* ²ļϲΪһĵ, ȡ, ޹; ̨߳ÿһ²ļ, ޸ʱ´ζȡʱºϲ.
+	* ²еļ޷ɾ, עֻȡϲ. Դͬһ·ʵЧ
+	*/
+	void setLayers(const QStringList& filePaths);
+
+	/*
+	* @brief ȡ²ļ
+	* @return ӵ͵еļ·
+	*/
+	QStringList layers() const;
+
+	/*
+	* @brief Ŀ¼еƬΪ²(conf.d)
+	* @param dirPath Ŀ¼, е*.iniļӵ͵ߵ, Ƭθǰ
+	* @note ͬļsetLayers, Ƭ̳߳вжȡ.
+	* Ŀ¼ɾƬκٴε, Ƭα޸ʱԶ¼
+	*/
+	void setFragmentDir(const QString& dirPath);
+
+	/*
+	* @brief ȡԴ
+	* @param key 
+	* @return üļ·, ϲΪʵļ, ʱؿ
+	*/
+	QString provenance(const QString& key) const;
+
+	/*
+	* @brief ȽINI
+	* @param other ĿINI
+	* @return ʵΪother޸, ֻȽϸԵļ, ²
+	* @note ڸԵڸĵ󰴽ĹϣȽ, ÿֻһ, κ
+	*/
+	IniDiff diff(const Ini& other) const;
+
+	/*
+	* @brief Ӧò
+	* @param patch diffɵĲ
+	* @return д̳ɹtrue, ʧܷfalse
+	* @note ޸һμ, ֻдһ, ֻյһ֪ͨ.
+	* ɾĽͬעһɾ, ĿսҲᴴ
+	*/
+	bool applyPatch(const IniDiff& patch);
+
+	/*
+	* @brief д̵ĳ־û
+	* @param durability ־û, ĬΪDurability::Flush
+	* @note ԽԽȫ, д̺ʱҲԽ. ׷־ʱFsyncϼ׷Ӻˢ־ļ.
+	* Դͬһ·ʵЧ
+	*/
+	void setDurability(Durability durability);
+
+	/*
+	* @brief ȡд̵ĳ־û
+	* @return ־û
+	*/
+	Durability durability() const;
+
+	/*
+	* @brief ޸
+	* @param keyOrGroupPrefix ·, "app""app/file_size", Ϊʱ޸
+	* @param callback ص
+	* @return ı, ȡ
+	* @note ʵsetValue, remove, rename޸, Լ¼ʱ̵ֵ޸Ķ֪ͨ.
+	* ͬһύ(һremoverename)е޸ĺϲΪһλص. صںִ̨߳, κڲ,
+	* ڻصждûȡ. δʱûж⿪
+	*/
+	int subscribe(const QString& keyOrGroupPrefix, IniChangeCb callback);
+
+	/*
+	* @brief ȡ
+	* @param id ı
+	* @note غصٱ(ڻصȡʱ), ʱԶȡʵж
+	*/
+	void unsubscribe(int id);
+
+	/*
+	* @brief ȡͳϢ
+	* @return ʵĴʱ, Լ·Ķд
+	* @note ̵߳, ȡ, ֤˴ϸһ
+	*/
+	IniStats stats() const;
+
+	/*
+	* @brief 㱾ʵͳϢ
+	* @note ·Ķд
+	*/
+	void resetStats();
+
+	/*
+	* @brief ĵȴͳ
+	* @param enable Ƿ, Ĭϲ
+	* @note úÿμһμʱ, stats()mutexes
+	*/
+	void enableLockStats(bool enable = true);
+
+#ifdef LIBINI_TRACE
+	/*
+	* @brief 
+	* @param filePath ļ·, ΪChromeٸʽ(JSON), chrome://tracingPerfetto
+	* @return ɹtrue, ʧܷfalse
+	* @note ڹ̶LIBINI_TRACEʱ, ¼·, , дļ, , ӽ,
+	* лȽ׶εĺʱ. Ѽ¼
+	*/
+	static bool saveTrace(const QString& filePath);
+#endif
+
 	/*
 	* @brief ĵ
 	* @return ĵ
 	*/
 	int ctxCount() const;
 
+	/*
+	* @brief ͬ
+	* @return ɹtrue, ʧܷfalse
+	* @note дδд̵޸(׷־ʱϲ־), ¼ر޸Ĺļ
+	*/
+	bool sync();
+
+	//=====================================================================
+	// ļ
+	//=====================================================================
+
+	/*
+	* @brief ÿļ
+	* @param[in] enable Ƿ
+	* @param[in] timeout ȴĳʱʱ(), -1ʾһֱȴ
+	* @note úļʱй, дʱжռ, ļΪ<file>.lock
+	* @note öԱڴͬһ·ʵЧ
+	*/
+	void enableFileLock(bool enable = true, int timeout = -1);
+
+	/*
+	* @brief ʽȡļ
+	* @param[in] exclusive Ƿռ, Ϊ
+	* @param[in] timeout ʱʱ(), -1ʾһֱȴ
+	* @return ɹtrue, ʱfalse
+	* @note ڿ̵Ķ--д, йڼ޸releaseFileLockʱд
+	*/
+	bool acquireFileLock(bool exclusive = true, int timeout = -1);
+
+	/*
+	* @brief Իȡļ, ȴ
+	* @param[in] exclusive Ƿռ, Ϊ
+	* @return ɹtrue, ʧܷfalse
+	*/
+	bool tryAcquireFileLock(bool exclusive = true);
+
+	/*
+	* @brief ͷʽȡĿļ
+	*/
+	void releaseFileLock();
+
+	//=====================================================================
+	// ̨д
+	//=====================================================================
+
+	/*
+	* @brief ų́д
+	* @param[in] enable Ƿ
+	* @param[in] delay дǰȴϲ޸ĵʱ()
+	* @note úsetValue/setComment/remove޸ڴ, ɺ̨̺߳ϲд.
+	* дǰ(ļвڻдʧʱ)ȡҲõ޸ĺֵ
+	* @note رʱдδд̵޸
+	*/
+	void enableAsyncWrite(bool enable = true, int delay = 50);
+
+	/*
+	* @brief ̨߳д
+	* @return д̽, ɹΪtrue
+	*/
+	QFuture<bool> flushAsync();
+
+	/*
+	* @brief ȴ޸д
+	* @param[in] timeout ʱʱ(), -1ʾһֱȴ
+	* @return ȫд̷true, ʱfalse
+	* @note ڳ˳ǰȷ
+	*/
+	bool waitForFlush(int timeout = -1);
+
+	//=====================================================================
+	// 첽
+	//=====================================================================
+
+	/*
+	* @brief ڹ߳дINI
+	* @param[in] filePath INIļ·
+	* @param[in] encryptData Ƿݼ
+	* @return ()ɵINI
+	* @note ڳʱǰؽϴļ, ʼ
+	*/
+	static QFuture<QSharedPointer<Ini>> openAsync(const QString& filePath = QString(), bool encryptData = false);
+
+	/*
+	* @brief ڹ߳Ԥȼ()ļ
+	* @return ʱ
+	* @note Ϊʾ, ǰĶȡȴؽ
+	*/
+	QFuture<void> preload() const;
+
 protected:
 	/**
 	 * @brief ͼ
@@ -401,6 +807,15 @@ protected:
 	 */
 	void buildGroupAndKeyName(const QString& key, QString& groupName, QString& keyName) const;
 
+	/**
+	 * @brief Ĳּ, keyеַ
+	 * @param[in] key 
+	 * @param[out] groupName , /ʱΪ
+	 * @param[out] keyName 
+	 * @return ʱfalse, ʹbuildGroupAndKeyName
+	 */
+	bool splitGroupAndKeyName(QStringView key, QStringView& groupName, QStringView& keyName) const;
+
 	/**
 	 * @brief Ƿڵڲ
 	 * @param[in] key 
@@ -466,6 +881,14 @@ protected:
 	*/
 	QVector<QPair<QString, QString>> childProperties(const QString& group) const;
 
+	/*
+	* @brief ȡǰĶӦĽڼ·
+	* @param[in] index Ƿ±
+	* @param[out] path ڵļ·, /ֲ㼶
+	* @return , ڷʱؿ
+	*/
+	QString ctxPath(bool index, QString* path) const;
+
 	// 
 	struct Ctx {
 		QString group;
@@ -492,8 +915,9 @@ protected:
 
 	/*
 	* @brief ļ
+	* @param site λ, ͳ
 	*/
-	void fileLock() const;
+	void fileLock(const char* site) const;
 
 	/*
 	* @brief ļ
@@ -542,7 +966,7 @@ private:
 	* @param[out] result ȡĽ
 	* @return ضȡֵ
 	*/
-	QString readFileData(const QString& group, const QString& key, const QString& defaultValue, const QString& filePath, bool* result = nullptr) const;
+	QString readFileData(QStringView group, QStringView key, const QString& defaultValue, const QString& filePath, bool* result = nullptr) const;
 
 	/*
 	* @brief дļ
@@ -563,6 +987,40 @@ private:
 	*/
 	bool removeFileData(const QString& group, const QString& key, const QString& filePath) const;
 
+	/*
+	* @brief Ƴ·֮µļ
+	* @param[in] group 
+	* @param[in] path ڵļ·, /ֲ㼶
+	* @param[in] filePath ļ·
+	* @return ݱƳtrue, 򷵻false
+	*/
+	bool removePathData(const QString& group, const QString& path, const QString& filePath) const;
+
+	/*
+	* @brief ƶ·֮µļ
+	* @param[in] group Դ
+	* @param[in] path Դڵļ·, /ֲ㼶, ΪʱΪ
+	* @param[in] toGroup Ŀ
+	* @param[in] toPath Ŀڵļ·, /ֲ㼶, ΪʱΪ鱾
+	* @param[in] conflict ĿѴʱĴʽ
+	* @param[in] filePath ļ·
+	* @param[out] moved ƶļ, Ϊ(ɼ, ¼), \ֲ㼶, Ϊnullptr
+	* @return ƶļ, ͻĿλԴ֮ʱ-1
+	*/
+	int movePathData(const QString& group, const QString& path, const QString& toGroup, const QString& toPath,
+		Conflict conflict, const QString& filePath, QVector<QPair<QString, QString>>* moved = nullptr) const;
+
+	/*
+	* @brief ע͸ƶļ
+	* @param[in] group Դ
+	* @param[in] toGroup Ŀ
+	* @param[in] toPath Ŀ·, /ֲ㼶, ΪʱΪ鱾
+	* @param[in] moved ֵʵƶļ, Ϊ(ɼ, ¼), \ֲ㼶
+	* @param[in] replace Ŀ·Ƿ滻(Conflict::Overwrite), ΪtrueʱɾĿ·ԭеע
+	*/
+	void moveComments(const QString& group, const QString& toGroup, const QString& toPath,
+		const QVector<QPair<QString, QString>>& moved, bool replace) const;
+
 	/*
 	* @brief ļ
 	* @param[in] group 
@@ -570,7 +1028,99 @@ private:
 	* @param[in] filePath ļ·
 	* @return ɹtrue, ʧܷfalse
 	*/
-	bool containsFileData(const QString& group, const QString& key, const QString& filePath) const;
+	bool containsFileData(QStringView group, QStringView key, const QString& filePath) const;
+
+	/*
+	* @brief ȡм
+	* @param[in] group 
+	* @return б, /ֲ㼶
+	*/
+	QStringList sectionKeys(const QString& group) const;
+
+	/*
+	* @brief ȡ·һӼ
+	* @param[in] group 
+	* @param[in] path ڵļ·, /ֲ㼶, Ϊʱʾ
+	* @param[in] groups Ϊtrueʱȡ, ȡӼ
+	* @return Ӽб
+	*/
+	QStringList pathChildren(const QString& group, const QString& path, bool groups) const;
+
+	/*
+	* @brief ȡ·µм
+	* @param[in] group 
+	* @param[in] path ڵļ·, /ֲ㼶
+	* @param[in] filePath ļ·
+	* @return pathļб, /ֲ㼶
+	*/
+	QStringList pathKeys(const QString& group, const QString& path, const QString& filePath) const;
+
+	/*
+	* @brief ȡС
+	* @param[in] group 
+	* @param[in] path ļ·, /ֲ㼶
+	* @return С, ʱ-1
+	*/
+	int pathArraySize(const QString& group, const QString& path) const;
+
+	/*
+	* @brief ·ǷΪ
+	* @param[in] group 
+	* @param[in] path ڵļ·, /ֲ㼶
+	* @return Ƿ鷵true, 򷵻false
+	*/
+	bool pathIsGroup(const QString& group, const QString& path) const;
+
+	/*
+	* @brief ȡн
+	* @param[in] filePath ļ·
+	* @return б
+	*/
+	QStringList sectionNames(const QString& filePath) const;
+
+	/*
+	* @brief ͬһ·ĵ
+	*/
+	void attachStore();
+
+	/*
+	* @brief 뿪ͬһ·ĵ
+	*/
+	void detachStore();
+
+	/*
+	* @brief дδд̵޸
+	* @return ɹtrue, ʧܷfalse
+	*/
+	bool flush() const;
+
+	/*
+	* @brief ύ޸, Ƿų́д̾д̻򽻸̨߳
+	* @return ɹtrue, ʧܷfalse
+	*/
+	bool commit() const;
+
+	/*
+	* @brief ļ, üʱԤȽֵ
+	*/
+	void load() const;
+
+	// ޸, ʱͳһд
+	class UpdateLocker {
+	public:
+		explicit UpdateLocker(const Ini* ini) : ini_(ini) {
+			++ini_->update_depth_;
+		}
+		~UpdateLocker() {
+			if (--ini_->update_depth_ == 0) {
+				ini_->commit();
+			}
+		}
+	private:
+		UpdateLocker(const UpdateLocker&) = delete;
+		UpdateLocker& operator=(const UpdateLocker&) = delete;
+		const Ini* ini_;
+	};
 
 private:
 	//=====================================================================
@@ -586,5 +1136,155 @@ private:
 	ULONG_PTR crypt_prov_ = 0;                     // ܷṩ߾
 	ULONG_PTR crypt_hash_ = 0;                     // ϣ
 	ULONG_PTR crypt_key_ = 0;                      // Կ
+	std::shared_ptr<ini::Store> store_;            // ͬһ·ĵ
+	mutable int update_depth_ = 0;                 // ޸Ƕ
+	bool async_write_ = false;                     // Ƿ̨д
+	std::unique_ptr<ini::Stats> stats_;            // ͳϢ
+};
+
+
+class QIODevice;
+
+/*
+* @brief ʽȡ¼
+*/
+struct IniEvent {
+	enum Type {
+		Section,                       // ڿʼ
+		Value,                         // ֵ
+		Comment,                       // ;ͷע
+	};
+
+	Type type = Section;
+	QString group;                     // ڵĽ
+	QString key;                       // ·, Iniһ/ֲ㼶
+	QString value;                     // ֵ, Ini::valueһȥɶԵ; עΪ;֮
+	QString arrayPrefix;               // ΪԪʱ·(), ֱӴbeginReadArray
+	int arrayIndex = -1;               // ΪԪʱ±, 0ʼ, setArrayIndexһ
+	qint64 line = 0;                   // к, 1ʼ
 };
 
+// ʽȡĻص, falseʱֹͣȡ
+using IniReaderCb = ::std::function<bool(const IniEvent& event)>;
+
+/*
+* @brief ʽINIȡ
+* @note ֿȡ豸в¼, ڴռļС޹, ʺɨ賬ļ.
+* ʶIniͬ(UTF-16 BOM, UTF-8, ر), , һ֮ǰIniһ
+*/
+class IniReader {
+public:
+	/*
+	* @brief 캯
+	* @param[in] chunkSize ÿδ豸ȡֽ
+	*/
+	explicit IniReader(int chunkSize = 64 * 1024);
+
+	/*
+	* @brief ȡ豸ֱصfalse
+	* @param[in] device Ѵ򿪵豸, QFile, QProcess, QBuffer
+	* @param[in] callback ¼ص, ڵִ߳
+	* @return ȡtrue, 豸ɶصֹfalse
+	*/
+	bool read(QIODevice* device, IniReaderCb callback) const;
+
+	/*
+	* @brief ȡָļ, ȫҵֹͣȡ
+	* @param[in] device Ѵ򿪵豸
+	* @param[in] keyPaths ·, ʽΪ"/·", ִСд, ظļԵһγֵΪ׼
+	* @return · -> ֵ, δҵļ
+	*/
+	QMap<QString, QString> extract(QIODevice* device, const QStringList& keyPaths) const;
+
+private:
+	int chunk_size_;
+};
+
+/*
+* @brief ʽINIд
+* @note ֱд豸, һϴĻ, ڴĵ, ʺɳļ.
+* ֵĸʽIni::setValueͬ, ļΪBOMUTF-8. ʱдʣ, ر豸
+*/
+class IniWriter {
+public:
+	// ڼ˳
+	enum class KeyOrder {
+		Written,    // д˳
+		Sorted,     // , 軺浱ǰڵм, ڽʱд
+	};
+
+	// з
+	enum class LineEnding {
+		CrLf,       // \r\n, Iniдļһ
+		Lf,         // \n
+	};
+
+	/*
+	* @brief 캯
+	* @param[in] device Ѵ򿪵Ŀд豸, QFile, QBuffer
+	*/
+	explicit IniWriter(QIODevice* device);
+	~IniWriter();
+
+	void setKeyOrder(KeyOrder order);
+	void setLineEnding(LineEnding ending);
+
+	/*
+	* @brief ûС
+	* @param[in] size ֵֽʱд豸
+	*/
+	void setBufferSize(int size);
+
+	/*
+	* @brief ʼһ, һ
+	* @param[in] name 
+	*/
+	void beginSection(const QString& name);
+
+	/*
+	* @brief дֵ, δʼκνʱдGeneral
+	* @param[in] key ·, /ֲ㼶, "array/1/name"
+	* @param[in] value ֵ
+	*/
+	void setValue(const QString& key, const Variant& value);
+
+	/*
+	* @brief д豸, ʱǰڵļڽڽд
+	* @return ɹtrue, дfalse
+	*/
+	bool flush();
+
+	/*
+	* @brief ǰڲд
+	* @return ɹtrue, дfalse
+	*/
+	bool finish();
+
+	// Ƿд
+	bool hasError() const;
+
+	/*
+	* @brief ֵתΪдļı, Ini::setValueĸʽͬ
+	* @param[in] value ֵ
+	* @return ı, ַбΪ{"a", "b"}, JSONΪոʽ, ֽΪ{0x01,0x02}, ΧΪx~y
+	*/
+	static QString encode(const Variant& value);
+
+private:
+	IniWriter(const IniWriter&) = delete;
+	IniWriter& operator=(const IniWriter&) = delete;
+
+	void endSection();
+	void appendValue(const QString& key, const QString& value);
+	bool write(int threshold);
+
+	QIODevice* device_;
+	KeyOrder key_order_ = KeyOrder::Written;
+	QByteArray eol_ = "\r\n";
+	int buffer_size_ = 1024 * 1024;
+	QByteArray buffer_;                        // δд豸
+	bool in_section_ = false;                  // Ƿѿʼ
+	bool first_section_ = true;                // һ֮ǰ
+	QVector<QPair<QString, QString>> pending_; // ʱǰδдļֵ
+	bool error_ = false;
+};
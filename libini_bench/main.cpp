@@ -0,0 +1,444 @@
+#include <QtCore/QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QHash>
+#include <QVector>
+#include <QTextStream>
+#include "../libini/libini.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// ѹ: д߳, ʵͬʱͬһINIļ, ͳ, ӳ
+
+namespace {
+	struct Options {
+		int readers = 4;               // ߳
+		int writers = 2;               // д߳
+		int instances = 2;             // ͬһļIniʵ
+		int groups = 8;                // ÿд߳дķ
+		int keys = 16;                 // ÿÿд߳дļ
+		int arrays = 2;                // 
+		int arraySize = 16;            // 鳤
+		int duration = 3000;           // ÿʱ()
+		bool async = false;            // ̨д
+		bool journal = false;          // ׷־
+		bool encrypt = false;          // 
+		QVector<Ini::Durability> durabilities{ Ini::Durability::Flush };
+	};
+
+	enum Operation {
+		Read,
+		Write,
+		ArrayRead,
+		ArrayWrite,
+		OperationCount,
+	};
+
+	const char* kOperationNames[OperationCount] = { "read", "write", "array read", "array write" };
+
+	// ÿٴβдһ
+	constexpr int kArrayInterval = 64;
+
+	struct ThreadResult {
+		QVector<qint64> latencies[OperationCount];     // 
+		qint64 errors = 0;
+		QHash<QString, qint64> last;                   // д߳:  -> д
+	};
+
+	inline QString groupName(int g) {
+		return QString("group%1").arg(g);
+	}
+
+	inline QString keyName(int writer, int k) {
+		return QString("w%1_k%2").arg(writer).arg(k);
+	}
+
+	inline QString arrayName(int a) {
+		return QString("array%1").arg(a);
+	}
+
+	const char* durabilityName(Ini::Durability durability) {
+		switch (durability) {
+		case Ini::Durability::None:
+			return "none";
+		case Ini::Durability::Flush:
+			return "flush";
+		case Ini::Durability::Fsync:
+			return "fsync";
+		case Ini::Durability::FsyncDir:
+			return "fsyncdir";
+		}
+		return "";
+	}
+
+	// ٷλ(΢), samples
+	double percentile(const QVector<qint64>& samples, double percent) {
+		if (samples.isEmpty()) {
+			return 0.0;
+		}
+		auto index = std::min<int>(samples.size() - 1, static_cast<int>(samples.size() * percent / 100.0));
+		return samples[index] / 1000.0;
+	}
+
+	void writer(Ini* ini, int id, const Options& opt, const std::atomic<bool>& stop, ThreadResult& result) {
+		QElapsedTimer timer;
+		qint64 seq = 0;
+		while (!stop) {
+			++seq;
+			if (opt.arrays > 0 && seq % kArrayInterval == 0) {
+				auto a = static_cast<int>((seq / kArrayInterval) % opt.arrays);
+				timer.start();
+				ini->beginWriteArray(arrayName(a), opt.arraySize);
+				for (int i = 0; i < opt.arraySize; ++i) {
+					ini->setArrayIndex(i);
+					ini->setValue("value", QString::number(seq));
+				}
+				ini->endArray();
+				result.latencies[ArrayWrite].append(timer.nsecsElapsed());
+				continue;
+			}
+
+			auto g = static_cast<int>(seq % opt.groups);
+			auto k = static_cast<int>((seq / opt.groups) % opt.keys);
+			timer.start();
+			ini->beginGroup(groupName(g));
+			ini->setValue(keyName(id, k), QString::number(seq));
+			ini->endGroup();
+			result.latencies[Write].append(timer.nsecsElapsed());
+			result.last[groupName(g) + "/" + keyName(id, k)] = seq;
+		}
+	}
+
+	void reader(Ini* ini, const Options& opt, const std::atomic<bool>& stop, ThreadResult& result) {
+		QElapsedTimer timer;
+		QRandomGenerator random(QRandomGenerator::global()->generate());
+		QHash<QString, qint64> seen;       // ͬһڵĶȡӦŻ
+		qint64 count = 0;
+		while (!stop) {
+			++count;
+			if (opt.arrays > 0 && count % kArrayInterval == 0) {
+				auto a = random.bounded(opt.arrays);
+				timer.start();
+				auto size = ini->beginReadArray(arrayName(a));
+				auto valid = size == opt.arraySize;
+				for (int i = 0; i < size; ++i) {
+					ini->setArrayIndex(i);
+					bool ok = false;
+					ini->value("value").toString().toLongLong(&ok);
+					valid = valid && ok;
+				}
+				ini->endArray();
+				result.latencies[ArrayRead].append(timer.nsecsElapsed());
+				if (!valid) {
+					++result.errors;
+				}
+				continue;
+			}
+
+			auto group = groupName(random.bounded(opt.groups));
+			auto key = keyName(random.bounded(opt.writers), random.bounded(opt.keys));
+			timer.start();
+			ini->beginGroup(group);
+			auto value = ini->value(key).toString();
+			ini->endGroup();
+			result.latencies[Read].append(timer.nsecsElapsed());
+
+			bool ok = false;
+			auto seq = value.toLongLong(&ok);
+			auto& last = seen[group + "/" + key];
+			if (!ok || seq < last) {
+				++result.errors;
+			}
+			else {
+				last = seq;
+			}
+		}
+	}
+
+	void configure(Ini& ini, const Options& opt, Ini::Durability durability) {
+		ini.setDurability(durability);
+		ini.enableJournal(opt.journal);
+		if (opt.async) {
+			ini.enableAsyncWrite();
+		}
+	}
+
+	// ʽȡBOMļ, ֵ¼ӦIni::allKeysһ, СļԸǿ
+	bool checkReader(QTextStream& out) {
+		QTemporaryDir dir;
+		auto path = dir.filePath("reader.ini");
+		QFile file(path);
+		if (!dir.isValid() || !file.open(QFile::WriteOnly)) {
+			out << "failed to create reader test file" << endl;
+			return false;
+		}
+		for (int g = 0; g < 16; ++g) {
+			file.write(QString("[%1]\r\n").arg(groupName(g)).toUtf8());
+			for (int k = 0; k < 64; ++k) {
+				file.write(QString("%1=%2\r\n").arg(keyName(g, k)).arg(k).toUtf8());
+			}
+		}
+		file.close();
+
+		int events = 0;
+		file.open(QFile::ReadOnly);
+		IniReader(1024).read(&file, [&events](const IniEvent& event) {
+			if (event.type == IniEvent::Value) {
+				++events;
+			}
+			return true;
+			});
+		file.close();
+
+		auto keys = Ini(path).allKeys().size();
+		out << "reader: events=" << events << " keys=" << keys << (events == keys ? " PASS" : " FAIL") << endl;
+		return events == keys;
+	}
+
+	// ӦòɾĽڲ¿սͷ, ֻĿеĿսڱ
+	bool checkPatch(QTextStream& out) {
+		QTemporaryDir dir;
+		auto write = [&dir](const QString& name, const QByteArray& data) {
+			QFile file(dir.filePath(name));
+			return file.open(QFile::WriteOnly) && file.write(data) == data.size();
+		};
+		if (!dir.isValid() || !write("from.ini", "[a]\r\nk=1\r\n[b]\r\nk=2\r\n") || !write("to.ini", "[a]\r\nk=1\r\n[c]\r\n")) {
+			out << "failed to create patch test files" << endl;
+			return false;
+		}
+
+		Ini from(dir.filePath("from.ini"));
+		Ini to(dir.filePath("to.ini"));
+		from.applyPatch(from.diff(to));
+		auto result = !from.contains("b") && from.contains("c") && from.value("a/k").toInt() == 1 && from.diff(to).isEmpty();
+		out << "patch: groups=" << from.childGroups().join(',') << (result ? " PASS" : " FAIL") << endl;
+		return result;
+	}
+
+	// ļдǰ(̨дֻ̻д־)ҲӦܶдֵ
+	bool checkReadYourWrites(QTextStream& out) {
+		QTemporaryDir dir;
+		if (!dir.isValid()) {
+			out << "failed to create temporary directory" << endl;
+			return false;
+		}
+
+		auto failures = 0;
+		for (auto journal : { false, true }) {
+			Ini ini(dir.filePath(journal ? "journal.ini" : "async.ini"));
+			ini.enableAsyncWrite(!journal, 1000);
+			ini.enableJournal(journal);
+			for (int k = 0; k < 16; ++k) {
+				auto path = groupName(0) + "/" + keyName(0, k);
+				ini.setValue(path, k);
+				if (ini.value(path).toInt() != k || !ini.contains(path)) {
+					++failures;
+				}
+
+				// QStringViewQString汾һ
+				ini.setValue(QStringView(path), k + 1);
+				if (ini.value(QStringView(path)).toInt() != k + 1 || !ini.contains(QStringView(path)) ||
+					ini.value(path).toInt() != k + 1) {
+					++failures;
+				}
+			}
+		}
+
+		out << "read your writes: failures=" << failures << (failures == 0 ? " PASS" : " FAIL") << endl;
+		return failures == 0;
+	}
+
+	// һ, Уʧʱfalse
+	bool run(const Options& opt, Ini::Durability durability, QTextStream& out) {
+		QTemporaryDir dir;
+		if (!dir.isValid()) {
+			out << "failed to create temporary directory" << endl;
+			return false;
+		}
+		auto path = dir.filePath("bench.ini");
+
+		// Ԥдм, ֵ̲߳
+		{
+			Ini ini(path, opt.encrypt);
+			configure(ini, opt, durability);
+			for (int g = 0; g < opt.groups; ++g) {
+				ini.beginGroup(groupName(g));
+				for (int w = 0; w < opt.writers; ++w) {
+					for (int k = 0; k < opt.keys; ++k) {
+						ini.setValue(keyName(w, k), "0");
+					}
+				}
+				ini.endGroup();
+			}
+			for (int a = 0; a < opt.arrays; ++a) {
+				ini.beginWriteArray(arrayName(a), opt.arraySize);
+				for (int i = 0; i < opt.arraySize; ++i) {
+					ini.setArrayIndex(i);
+					ini.setValue("value", "0");
+				}
+				ini.endArray();
+			}
+			ini.sync();
+		}
+
+		std::vector<std::unique_ptr<Ini>> instances;
+		for (int i = 0; i < opt.instances; ++i) {
+			instances.emplace_back(new Ini(path, opt.encrypt));
+			configure(*instances.back(), opt, durability);
+		}
+
+		std::atomic<bool> stop{ false };
+		QVector<ThreadResult> writerResults(opt.writers);
+		QVector<ThreadResult> readerResults(opt.readers);
+		std::vector<std::thread> threads;
+		QElapsedTimer elapsed;
+		elapsed.start();
+		for (int i = 0; i < opt.writers; ++i) {
+			threads.emplace_back(writer, instances[i % opt.instances].get(), i, std::cref(opt), std::cref(stop), std::ref(writerResults[i]));
+		}
+		for (int i = 0; i < opt.readers; ++i) {
+			threads.emplace_back(reader, instances[i % opt.instances].get(), std::cref(opt), std::cref(stop), std::ref(readerResults[i]));
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(opt.duration));
+		stop = true;
+		for (auto& x : threads) {
+			x.join();
+		}
+		auto seconds = elapsed.nsecsElapsed() / 1e9;
+
+		auto stats = instances.front()->stats();
+		instances.clear();
+
+		// ӳ
+		out << "durability=" << durabilityName(durability)
+			<< " readers=" << opt.readers << " writers=" << opt.writers << " instances=" << opt.instances
+			<< " async=" << opt.async << " journal=" << opt.journal << " encrypt=" << opt.encrypt << endl;
+		qint64 errors = 0;
+		for (int op = 0; op < OperationCount; ++op) {
+			QVector<qint64> samples;
+			for (const auto& results : { &writerResults, &readerResults }) {
+				for (const auto& x : *results) {
+					samples += x.latencies[op];
+				}
+			}
+			if (samples.isEmpty()) {
+				continue;
+			}
+
+			std::sort(samples.begin(), samples.end());
+			out << QString("  %1 ops=%2 ops/s=%3 p50=%4us p99=%5us p999=%6us max=%7us")
+				.arg(kOperationNames[op], -12)
+				.arg(samples.size())
+				.arg(samples.size() / seconds, 0, 'f', 0)
+				.arg(percentile(samples, 50), 0, 'f', 1)
+				.arg(percentile(samples, 99), 0, 'f', 1)
+				.arg(percentile(samples, 99.9), 0, 'f', 1)
+				.arg(samples.back() / 1000.0, 0, 'f', 1) << endl;
+		}
+		for (const auto& x : readerResults) {
+			errors += x.errors;
+		}
+		out << "  file reads=" << stats.fileReads << " writes=" << stats.fileWrites
+			<< " bytes written=" << stats.bytesWritten << " parses=" << stats.parses << endl;
+
+		// ´ļ, Уÿһдֵ
+		qint64 mismatches = 0;
+		Ini check(path, opt.encrypt);
+		for (const auto& result : writerResults) {
+			for (auto it = result.last.cbegin(); it != result.last.cend(); ++it) {
+				if (check.value(it.key()).toString().toLongLong() != it.value()) {
+					++mismatches;
+				}
+			}
+		}
+
+		// д߳̿ܽдͬһ, ֻУ鳤Ԫظʽ
+		for (int a = 0; a < opt.arrays; ++a) {
+			auto size = check.beginReadArray(arrayName(a));
+			if (size != opt.arraySize) {
+				++mismatches;
+			}
+			for (int i = 0; i < size; ++i) {
+				check.setArrayIndex(i);
+				bool ok = false;
+				check.value("value").toString().toLongLong(&ok);
+				if (!ok) {
+					++mismatches;
+				}
+			}
+			check.endArray();
+		}
+
+		out << "  integrity: read errors=" << errors << " final mismatches=" << mismatches
+			<< (errors == 0 && mismatches == 0 ? " PASS" : " FAIL") << endl;
+		return errors == 0 && mismatches == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCommandLineParser parser;
+	parser.setApplicationDescription("libini multi-threaded stress benchmark");
+	parser.addHelpOption();
+	QCommandLineOption readers("readers", "Reader threads.", "n", "4");
+	QCommandLineOption writers("writers", "Writer threads.", "n", "2");
+	QCommandLineOption instances("instances", "Ini instances on the same file.", "n", "2");
+	QCommandLineOption groups("groups", "Groups written by each writer.", "n", "8");
+	QCommandLineOption keys("keys", "Keys per group written by each writer.", "n", "16");
+	QCommandLineOption arrays("arrays", "Arrays rewritten by the writers.", "n", "2");
+	QCommandLineOption arraySize("array-size", "Array length.", "n", "16");
+	QCommandLineOption duration("duration", "Run time of each round in milliseconds.", "ms", "3000");
+	QCommandLineOption durability("durability", "none, flush, fsync, fsyncdir or all.", "level", "flush");
+	QCommandLineOption async("async", "Enable background writes.");
+	QCommandLineOption journal("journal", "Enable the append-only journal.");
+	QCommandLineOption encrypt("encrypt", "Encrypt values.");
+	parser.addOptions({ readers, writers, instances, groups, keys, arrays, arraySize, duration, durability, async, journal, encrypt });
+	parser.process(app);
+
+	Options opt;
+	opt.readers = std::max<int>(0, parser.value(readers).toInt());
+	opt.writers = std::max<int>(1, parser.value(writers).toInt());
+	opt.instances = std::max<int>(1, parser.value(instances).toInt());
+	opt.groups = std::max<int>(1, parser.value(groups).toInt());
+	opt.keys = std::max<int>(1, parser.value(keys).toInt());
+	opt.arrays = std::max<int>(0, parser.value(arrays).toInt());
+	opt.arraySize = std::max<int>(1, parser.value(arraySize).toInt());
+	opt.duration = std::max<int>(1, parser.value(duration).toInt());
+	opt.async = parser.isSet(async);
+	opt.journal = parser.isSet(journal);
+	opt.encrypt = parser.isSet(encrypt);
+
+	auto level = parser.value(durability).toLower();
+	if (level == "all") {
+		opt.durabilities = { Ini::Durability::None, Ini::Durability::Flush, Ini::Durability::Fsync, Ini::Durability::FsyncDir };
+	}
+	else {
+		opt.durabilities.clear();
+		for (auto x : { Ini::Durability::None, Ini::Durability::Flush, Ini::Durability::Fsync, Ini::Durability::FsyncDir }) {
+			if (level == durabilityName(x)) {
+				opt.durabilities.append(x);
+			}
+		}
+		if (opt.durabilities.isEmpty()) {
+			parser.showHelp(1);
+		}
+	}
+
+	QTextStream out(stdout);
+	auto success = checkReader(out);
+	success = checkReadYourWrites(out) && success;
+	success = checkPatch(out) && success;
+	for (auto x : opt.durabilities) {
+		success = run(opt, x, out) && success;
+	}
+	return success ? 0 : 1;
+}